@@ -0,0 +1,164 @@
+/*
+ * FILE: bench_checksum.cc
+ * DESCRIPTION: Microbenchmark of the packet checksum kernels.
+ *
+ *       Checksums buffers of an ack header (6 bytes), a short packet, a full
+ *       packet (RDT_PKTSIZE) and a large 4KB buffer with every kernel in
+ *       rdt_checksum.h, and reports bytes per cycle (TSC cycles on x86, per
+ *       nanosecond elsewhere).  "short" is the ack fast path, only defined
+ *       up to 8 bytes.  All kernels are first checked against the bytewise
+ *       crc16 and the bitwise crc32c on random buffers of every length.
+ *
+ *       usage: bench_checksum
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "rdt_struct.h"
+#include "rdt_checksum.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+
+/* minimum wall-clock time spent measuring one configuration (in seconds) */
+#define BENCH_MIN_TIME 0.1
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* cycles, or nanoseconds where there is no cycle counter */
+static double now_ticks()
+{
+#ifdef HAVE_RDTSC
+    return (double) __rdtsc();
+#else
+    return wall_time() * 1e9;
+#endif
+}
+
+/* xorshift64*, deterministic and independent of rand() */
+static unsigned long long bench_state = 88172645463325252ULL;
+
+static unsigned char bench_byte()
+{
+    bench_state ^= bench_state >> 12;
+    bench_state ^= bench_state << 25;
+    bench_state ^= bench_state >> 27;
+    return (unsigned char)((bench_state * 2685821657736338717ULL) >> 56);
+}
+
+/* keeps the results alive */
+static volatile uint32_t sink;
+
+struct kernel {
+    const char *name;
+    uint32_t (*fn)(const void *, size_t);
+    size_t max_len;
+};
+
+static uint32_t k_crc16_bytewise(const void *p, size_t n) { return Crc16_Bytewise(p, n); }
+static uint32_t k_crc16_slice8(const void *p, size_t n) { return Crc16_Slice8(p, n); }
+static uint32_t k_crc16_short(const void *p, size_t n) { return Checksum_Short(CSUM_CRC16, p, n); }
+static uint32_t k_crc32c_slice8(const void *p, size_t n) { return Crc32c_Slice8(p, n); }
+static uint32_t k_crc32c_sse42(const void *p, size_t n) { return Crc32c_Sse42(p, n); }
+static uint32_t k_crc32c_short(const void *p, size_t n) { return Checksum_Short(CSUM_CRC32C, p, n); }
+
+/* the definition, one bit at a time */
+static uint32_t crc32c_bitwise(const unsigned char *p, size_t n)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (n--) {
+	crc ^= *p++;
+	for (int j=0; j<8; j++)
+	    crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+    }
+    return ~crc;
+}
+
+static int verify(const struct kernel *kernels, int nkernels)
+{
+    unsigned char buf[512];
+    for (size_t i=0; i<sizeof(buf); i++) buf[i] = bench_byte();
+
+    for (size_t len=0; len<=sizeof(buf); len++)
+	for (size_t off=0; off<8 && off+len<=sizeof(buf); off++) {
+	    uint32_t c16 = Crc16_Bytewise(buf+off, len);
+	    uint32_t c32 = crc32c_bitwise(buf+off, len);
+	    for (int k=0; k<nkernels; k++) {
+		if (len>kernels[k].max_len) continue;
+		bool is16 = kernels[k].name[3]=='1';
+		uint32_t got = kernels[k].fn(buf+off, len);
+		if (got!=(is16 ? c16 : c32)) {
+		    fprintf(stderr, "%s: wrong checksum for %zu bytes at offset %zu\n",
+			    kernels[k].name, len, off);
+		    return -1;
+		}
+	    }
+	}
+    return 0;
+}
+
+/* bytes per tick of one kernel on len bytes */
+static double bench_one(const struct kernel *k, const unsigned char *buf, size_t len)
+{
+    long long nbytes = 0;
+    uint32_t acc = 0;
+    double start = wall_time(), t0 = now_ticks();
+    do {
+	for (int i=0; i<4096; i++)
+	    acc += k->fn(buf + (i & 7), len);
+	nbytes += 4096 * (long long) len;
+    } while (wall_time() - start<BENCH_MIN_TIME);
+    double ticks = now_ticks() - t0;
+    sink = acc;
+    return nbytes / ticks;
+}
+
+int main(int argc, char *argv[])
+{
+    struct kernel kernels[] = {
+	{"crc16 bytewise", k_crc16_bytewise, (size_t)-1},
+	{"crc16 slice8", k_crc16_slice8, (size_t)-1},
+	{"crc16 short", k_crc16_short, 8},
+	{"crc32c slice8", k_crc32c_slice8, (size_t)-1},
+	{"crc32c sse4.2", k_crc32c_sse42, (size_t)-1},
+	{"crc32c short", k_crc32c_short, 8},
+    };
+    int nkernels = sizeof(kernels) / sizeof(kernels[0]);
+    bool sse42 = Crc32c_HaveSse42();
+    if (!sse42) nkernels--, kernels[4] = kernels[5];
+
+    if (verify(kernels, nkernels)!=0) return 1;
+
+    static const size_t sizes[] = {6, 32, RDT_PKTSIZE, 4096};
+    static unsigned char buf[4096 + 8];
+    for (size_t i=0; i<sizeof(buf); i++) buf[i] = bench_byte();
+
+#ifdef HAVE_RDTSC
+    printf("bytes/cycle (TSC), SSE4.2 %s\n", sse42 ? "available" : "not available");
+#else
+    printf("bytes/ns\n");
+#endif
+    printf("%-16s", "kernel");
+    for (int j=0; j<4; j++) printf(" %9zuB", sizes[j]);
+    printf("\n");
+    for (int k=0; k<nkernels; k++) {
+	printf("%-16s", kernels[k].name);
+	for (int j=0; j<4; j++) {
+	    if (sizes[j]>kernels[k].max_len) printf(" %10s", "-");
+	    else printf(" %10.3f", bench_one(&kernels[k], buf, sizes[j]));
+	}
+	printf("\n");
+    }
+    return 0;
+}
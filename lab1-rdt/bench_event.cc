@@ -0,0 +1,108 @@
+/*
+ * FILE: bench_event.cc
+ * DESCRIPTION: Microbenchmark of the event chain scheduler backends.
+ *
+ *       Classic hold model: the queue is filled to a given depth, then every
+ *       step takes the next event and reschedules it a random interval into
+ *       the future, so the depth stays constant.  Every fourth step also
+ *       cancels a random pending event and schedules it again, the way the
+ *       simulator restarts the sender timer.  Reports events/sec for each
+ *       backend at each queue depth.
+ *
+ *       usage: bench_event [max_depth]
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "rdt_event.h"
+
+
+/* minimum wall-clock time spent measuring one configuration (in seconds) */
+#define BENCH_MIN_TIME 0.2
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* xorshift64*, deterministic and independent of rand() */
+static unsigned long long bench_state = 88172645463325252ULL;
+
+static double bench_random()
+{
+    bench_state ^= bench_state >> 12;
+    bench_state ^= bench_state << 25;
+    bench_state ^= bench_state >> 27;
+    return (bench_state * 2685821657736338717ULL >> 11) * (1.0/9007199254740992.0);
+}
+
+/* run the hold model on one backend, return events/sec */
+static double bench_one(int kind, int depth)
+{
+    EventChain chain(kind);
+    std::vector<Event> events(depth);
+
+    for (int i=0; i<depth; i++) {
+	events[i].sched_time = bench_random() * depth;
+	chain.schedule(&events[i]);
+    }
+
+    long long nevents = 0;
+    double start = wall_time(), elapsed;
+    do {
+	for (int i=0; i<1024; i++) {
+	    Event *e = chain.next_event();
+	    e->sched_time = chain.time() + bench_random() * depth;
+	    chain.schedule(e);
+
+	    if ((i & 3)==0) {
+		Event *c = &events[(int)(bench_random() * depth) % depth];
+		chain.cancel(c);
+		c->sched_time = chain.time() + bench_random() * depth;
+		chain.schedule(c);
+	    }
+	}
+	nevents += 1024;
+	elapsed = wall_time() - start;
+    } while (elapsed<BENCH_MIN_TIME);
+
+    return nevents / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_depth = 100000;
+    if (argc>1) max_depth = atoi(argv[1]);
+    if (max_depth<=0) {
+	fprintf(stderr, "usage: %s [max_depth]\n", argv[0]);
+	exit(-1);
+    }
+
+    fprintf(stdout, "## events/sec by queue depth (hold model, 25%% cancels)\n");
+    fprintf(stdout, "%10s", "depth");
+    for (int k=0; k<SCHED_NUM; k++)
+	fprintf(stdout, "%14s", EventQueue_Name(k));
+    fprintf(stdout, "\n");
+
+    for (int depth=1; depth<=max_depth; depth*=10) {
+	fprintf(stdout, "%10d", depth);
+	for (int k=0; k<SCHED_NUM; k++) {
+	    /* the list backend is quadratic, don't wait for it forever */
+	    if (k==SCHED_LIST && depth>10000) {
+		fprintf(stdout, "%14s", "-");
+		continue;
+	    }
+	    fprintf(stdout, "%14.0f", bench_one(k, depth));
+	    fflush(stdout);
+	}
+	fprintf(stdout, "\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * FILE: bench_reasm.cc
+ * DESCRIPTION: Microbenchmark of message reassembly at the receiver.
+ *
+ *       Feeds messages of 1KB, 64KB and 1MB to the receiver in packets of
+ *       a full v1 payload, in order, and reports delivered bytes/sec.
+ *       Compares the slice list the receiver used before rdt_reasm.h (a
+ *       malloc'd copy of every payload, then a malloc'd message they are
+ *       all copied into again) against the reassembly buffer.
+ *
+ *       usage: bench_reasm
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <list>
+
+#include "rdt_struct.h"
+#include "rdt_reasm.h"
+
+
+/* minimum wall-clock time spent measuring one configuration (in seconds) */
+#define BENCH_MIN_TIME 0.2
+
+/* payload of a v1 data packet */
+#define PAYLOAD (RDT_PKTSIZE - 4)
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* stands in for Receiver_ToUpperLayer(), looks at both ends of the message */
+static volatile long long delivered;
+
+static void deliver(const struct message *msg)
+{
+    delivered += msg->size + msg->data[0] + msg->data[msg->size - 1];
+}
+
+/* the old receiver: a list of slices, copied again into the final message */
+class SliceList
+{
+    std::list<struct message *> slices;
+
+public:
+    void submit(const char *data, int size, bool last) {
+	struct message *msg = (struct message *) malloc(sizeof(struct message));
+	msg->size = size;
+	msg->data = (char *) malloc(size);
+	memcpy(msg->data, data, size);
+	slices.push_back(msg);
+	if (!last) return;
+
+	int total = 0;
+	for (auto m : slices) total += m->size;
+	struct message *final_msg = (struct message *) malloc(sizeof(struct message));
+	final_msg->size = total;
+	final_msg->data = (char *) malloc(total);
+	int cursor = 0;
+	for (auto m : slices) {
+	    memcpy(final_msg->data + cursor, m->data, m->size);
+	    cursor += m->size;
+	    free(m->data);
+	    free(m);
+	}
+	slices.clear();
+	deliver(final_msg);
+	/* the upper layer never freed it; free it here to compare fairly */
+	free(final_msg->data);
+	free(final_msg);
+    }
+};
+
+class Reassembly
+{
+    struct reasm_buffer reasm;
+
+public:
+    Reassembly() { Reasm_Init(&reasm, 4096); }
+    ~Reassembly() { Reasm_Free(&reasm); }
+
+    void submit(const char *data, int size, bool last) {
+	Reasm_Append(&reasm, data, size);
+	if (!last) return;
+	struct message msg = Reasm_Message(&reasm);
+	deliver(&msg);
+	Reasm_Reset(&reasm);
+    }
+};
+
+/* deliver messages of msg_size bytes, return bytes/sec */
+template <class Receiver>
+static double bench_one(int msg_size)
+{
+    Receiver receiver;
+    struct packet pkt;
+    for (int i=0; i<RDT_PKTSIZE; i++) pkt.data[i] = '0' + i % 10;
+
+    long long nbytes = 0;
+    double start = wall_time(), elapsed;
+    do {
+	for (int m=0; m<16; m++) {
+	    for (int cursor=0; cursor<msg_size; cursor+=PAYLOAD) {
+		int size = msg_size - cursor<PAYLOAD ? msg_size - cursor : PAYLOAD;
+		receiver.submit(pkt.data + 4, size, cursor + size==msg_size);
+	    }
+	    nbytes += msg_size;
+	}
+	elapsed = wall_time() - start;
+    } while (elapsed<BENCH_MIN_TIME);
+
+    return nbytes / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int sizes[] = {1024, 65536, 1048576};
+
+    printf("%10s %16s %16s\n", "msg size", "slices MB/s", "reasm MB/s");
+    for (int i=0; i<3; i++) {
+	double slices = bench_one<SliceList>(sizes[i]);
+	double reasm = bench_one<Reassembly>(sizes[i]);
+	printf("%10d %16.1f %16.1f\n", sizes[i], slices / 1e6, reasm / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * FILE: bench_timer.cc
+ * DESCRIPTION: Microbenchmark of the sender retransmission timers.
+ *
+ *       Models a sender that keeps a window of W packets outstanding: every
+ *       step the oldest packet is acked and a new one is sent, every fourth
+ *       step a random outstanding packet is resent (a NAK) and every
+ *       sixteenth step the earliest timer times out and is restarted.
+ *       Compares the list-based timer chain the sender used before the timer
+ *       wheel against TimerWheel, and reports timer operations/sec at
+ *       window sizes 10, 100 and 1000.
+ *
+ *       usage: bench_timer
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <list>
+
+#include "rdt_timer.h"
+
+
+/* minimum wall-clock time spent measuring one configuration (in seconds) */
+#define BENCH_MIN_TIME 0.2
+
+#define TIME_OUT 0.3
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* xorshift64*, deterministic and independent of rand() */
+static unsigned long long bench_state = 88172645463325252ULL;
+
+static double bench_random()
+{
+    bench_state ^= bench_state >> 12;
+    bench_state ^= bench_state << 25;
+    bench_state ^= bench_state >> 27;
+    return (bench_state * 2685821657736338717ULL >> 11) * (1.0/9007199254740992.0);
+}
+
+/* stands in for Sender_StartTimer(), so restarts are not optimized away */
+static volatile double hw_timer;
+
+/* the old timer chain: timers in arming order, a timer removed from the
+   middle is only marked done and dropped once it reaches the front */
+class TimerChain
+{
+    struct timer {
+	int id;
+	double expire;
+	bool done;
+    };
+    std::list<timer> timers;
+
+    void drop_done() {
+	while (!timers.empty() && timers.front().done)
+	    timers.pop_front();
+	if (!timers.empty())
+	    hw_timer = timers.front().expire;
+    }
+
+public:
+    void set(int id, double expire) {
+	remove(id);
+	timer t = {id, expire, false};
+	timers.push_back(t);
+	if (timers.size()==1)
+	    hw_timer = expire;
+    }
+
+    void remove(int id) {
+	if (timers.empty()) return;
+	if (timers.front().id==id) {
+	    timers.pop_front();
+	    drop_done();
+	    return;
+	}
+	for (std::list<timer>::iterator it=timers.begin(); it!=timers.end(); ++it)
+	    if (it->id==id && !it->done) {
+		it->done = true;
+		return;
+	    }
+    }
+
+    int pop() {
+	int id = timers.front().id;
+	timers.pop_front();
+	drop_done();
+	return id;
+    }
+};
+
+/* the wheel, driving the simulator timer the way rdt_sender.cc does */
+class WheelTimers
+{
+    TimerWheel wheel;
+
+    void rearm() {
+	double next = wheel.next_expiry();
+	if (next>=0 && next!=hw_timer)
+	    hw_timer = next;
+    }
+
+public:
+    WheelTimers(int ntimers) : wheel(ntimers) {}
+
+    void set(int id, double expire) { wheel.set(id, expire); rearm(); }
+    void remove(int id) { wheel.cancel(id); rearm(); }
+
+    int pop() {
+	int id = wheel.pop_expired(1e300);
+	rearm();
+	return id;
+    }
+};
+
+/* run the sender model with window w, return timer operations/sec */
+template <class Timers>
+static double bench_one(int w)
+{
+    /* sequence numbers run over twice the window, like the v1 header */
+    int nseq = 2*w;
+    Timers timers(nseq);
+    double now = 0, step = TIME_OUT / w;
+    int oldest = 0;
+
+    for (int i=0; i<w; i++)
+	timers.set(i, now + TIME_OUT);
+
+    long long nops = 0;
+    double start = wall_time(), elapsed;
+    do {
+	for (int i=0; i<1024; i++) {
+	    now += step;
+	    timers.remove(oldest);
+	    timers.set((oldest + w) % nseq, now + TIME_OUT);
+	    oldest = (oldest + 1) % nseq;
+	    nops += 2;
+
+	    if ((i & 3)==0) {
+		int seq = (oldest + (int)(bench_random() * w) % w) % nseq;
+		timers.set(seq, now + TIME_OUT);
+		nops++;
+	    }
+	    if ((i & 15)==0) {
+		int seq = timers.pop();
+		timers.set(seq, now + TIME_OUT);
+		nops += 2;
+	    }
+	}
+	elapsed = wall_time() - start;
+    } while (elapsed<BENCH_MIN_TIME);
+
+    return nops / elapsed;
+}
+
+/* TimerChain ignores the number of timers */
+struct ChainTimers : TimerChain
+{
+    ChainTimers(int) {}
+};
+
+int main(int argc, char *argv[])
+{
+    static const int windows[] = {10, 100, 1000};
+
+    printf("%8s %14s %14s\n", "window", "chain ops/s", "wheel ops/s");
+    for (int i=0; i<3; i++) {
+	double chain = bench_one<ChainTimers>(windows[i]);
+	double wheel = bench_one<WheelTimers>(windows[i]);
+	printf("%8d %14.0f %14.0f\n", windows[i], chain, wheel);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * FILE: rdt_backpressure.h
+ * DESCRIPTION: Flow control between the upper layer and the rdt sender.
+ *
+ *       The sender keeps its window and its waiting packets in one send
+ *       buffer of rdt_config.send_buffer packets, one per connection (see
+ *       rdt_conn.h).  Before passing a message
+ *       to Sender_TakeMessage() (or Sender_FromUpperLayer()) the upper layer
+ *       asks Sender_WouldBlock(); if the message does not fit, it holds on
+ *       to it and stops producing until the sender calls Sender_Writable(),
+ *       once acks have freed enough room for that message.
+ *
+ *       Waiting packets are not built up front: the sender keeps the
+ *       messages themselves and cuts the next packet off the oldest one
+ *       only when the window lets it go out.
+ */
+
+
+#ifndef _RDT_BACKPRESSURE_H_
+#define _RDT_BACKPRESSURE_H_
+
+
+/* implemented by the sender: true if a message of size bytes does not fit
+   in the send buffer of connection conn right now.  the sender then calls
+   Sender_Writable() as soon as it does */
+bool Sender_WouldBlock(int conn, int size);
+
+/* implemented by the sender: like Sender_FromUpperLayer(), but without a
+   copy.  the sender takes ownership of msg and of msg->data, both from
+   malloc(), and frees them once the last packet of msg has been built */
+void Sender_TakeMessage(int conn, struct message *msg);
+
+/* implemented by the upper layer: the message Sender_WouldBlock() refused
+   for connection conn fits now */
+void Sender_Writable(int conn);
+
+#endif  /* _RDT_BACKPRESSURE_H_ */
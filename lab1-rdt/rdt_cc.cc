@@ -0,0 +1,191 @@
+/*
+ * FILE: rdt_cc.cc
+ * DESCRIPTION: Congestion control of the rdt sender.
+ */
+
+
+#include <string.h>
+
+#include "rdt_cc.h"
+
+
+static const char *cc_names[CC_NUM] = {"fixed", "reno", "vegas"};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  common part
+  []------------------------------------------------------------------------[]*/
+
+CongestionControl::CongestionControl(double initial, double max_cwnd)
+{
+    this->max_cwnd = max_cwnd;
+    cwnd = initial;
+    srtt = 0;
+    epoch_end = -1;
+    clamp();
+}
+
+bool CongestionControl::new_epoch(double now)
+{
+    if (now<epoch_end) return false;
+    /* before the first sample there is no RTT to group losses by */
+    epoch_end = now + srtt;
+    return true;
+}
+
+void CongestionControl::clamp()
+{
+    if (cwnd<1) cwnd = 1;
+    if (cwnd>max_cwnd) cwnd = max_cwnd;
+}
+
+void CongestionControl::on_rtt(double rtt, double now)
+{
+    srtt = srtt>0 ? srtt + (rtt - srtt)/8 : rtt;
+}
+
+int CongestionControl::window() const
+{
+    return (int) cwnd;
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  fixed window
+  []------------------------------------------------------------------------[]*/
+
+class FixedWindow : public CongestionControl
+{
+public:
+    FixedWindow(double window, double max_cwnd)
+	: CongestionControl(window, max_cwnd) {}
+
+    void on_ack(int packets) {}
+    void on_loss(bool timeout, double now) {}
+};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  reno: slow start and AIMD
+  []------------------------------------------------------------------------[]*/
+
+class RenoControl : public CongestionControl
+{
+    double ssthresh;
+
+public:
+    RenoControl(double max_cwnd)
+	: CongestionControl(CC_INITIAL_WINDOW, max_cwnd) { ssthresh = max_cwnd; }
+
+    void on_ack(int packets) {
+	for (int i=0; i<packets; i++)
+	    cwnd += cwnd<ssthresh ? 1 : 1/cwnd;
+	clamp();
+    }
+
+    void on_loss(bool timeout, double now) {
+	if (!new_epoch(now)) return;
+	ssthresh = cwnd/2<2 ? 2 : cwnd/2;
+	cwnd = timeout ? 1 : ssthresh;
+	clamp();
+    }
+};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  vegas: delay based
+  []------------------------------------------------------------------------[]*/
+
+/* rounds are compared by their mean RTT rather than single samples: a
+   reordered packet can come back well under the path's base RTT, and one
+   such sample would otherwise pin base_rtt far too low for good */
+class VegasControl : public CongestionControl
+{
+    double ssthresh;
+    double base_rtt;        /* smallest round mean, 0 before the first round */
+    double round_end;       /* end of the current measurement round */
+    double round_sum;       /* RTT samples of the round */
+    int round_samples;
+
+public:
+    VegasControl(double max_cwnd)
+	: CongestionControl(CC_INITIAL_WINDOW, max_cwnd) {
+	ssthresh = max_cwnd;
+	base_rtt = 0;
+	round_end = -1;
+	round_sum = 0;
+	round_samples = 0;
+    }
+
+    /* slow start grows per ack, everything else happens once per RTT */
+    void on_ack(int packets) {
+	if (cwnd<ssthresh) {
+	    cwnd += packets;
+	    clamp();
+	}
+    }
+
+    void on_rtt(double rtt, double now) {
+	CongestionControl::on_rtt(rtt, now);
+	round_sum += rtt;
+	round_samples++;
+	if (round_end<0) round_end = now + rtt;
+	if (now<round_end) return;
+
+	double round_rtt = round_sum / round_samples;
+	if (base_rtt==0 || round_rtt<base_rtt) base_rtt = round_rtt;
+	round_end = now + srtt;
+	round_sum = 0;
+	round_samples = 0;
+
+	/* backlog: packets queued in the network beyond the base RTT */
+	double diff = cwnd * (1 - base_rtt/round_rtt);
+	if (cwnd<ssthresh) {
+	    if (diff>VEGAS_ALPHA) {
+		/* leave slow start, the path is filling up */
+		ssthresh = cwnd;
+		cwnd -= diff - VEGAS_ALPHA;
+	    }
+	}
+	else if (diff<VEGAS_ALPHA)
+	    cwnd += 1;
+	else if (diff>VEGAS_BETA)
+	    cwnd -= 1;
+	clamp();
+    }
+
+    /* losses still halve the window, a timeout restarts slow start */
+    void on_loss(bool timeout, double now) {
+	if (!new_epoch(now)) return;
+	ssthresh = cwnd/2<2 ? 2 : cwnd/2;
+	cwnd = timeout ? 1 : ssthresh;
+	clamp();
+    }
+};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  controller selection
+  []------------------------------------------------------------------------[]*/
+
+CongestionControl *CC_Create(int kind, int window, int max_cwnd)
+{
+    switch (kind) {
+    case CC_FIXED: return new FixedWindow(window, max_cwnd);
+    case CC_VEGAS: return new VegasControl(max_cwnd);
+    default:       return new RenoControl(max_cwnd);
+    }
+}
+
+int CC_Parse(const char *name)
+{
+    for (int i=0; i<CC_NUM; i++)
+	if (strcmp(name, cc_names[i])==0) return i;
+    return -1;
+}
+
+const char *CC_Name(int kind)
+{
+    if (kind<0 || kind>=CC_NUM) return "unknown";
+    return cc_names[kind];
+}
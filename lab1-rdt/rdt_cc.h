@@ -0,0 +1,72 @@
+/*
+ * FILE: rdt_cc.h
+ * DESCRIPTION: Congestion control of the rdt sender.
+ *
+ *       The sender keeps at most window() packets outstanding and feeds
+ *       the controller every ack of new data, every valid RTT sample and
+ *       every loss.  Controllers are pluggable:
+ *
+ *         fixed   the original constant window (WINDOW_SIZE packets)
+ *                 (default)
+ *         reno    slow start, then additive increase / multiplicative
+ *                 decrease; a timeout restarts slow start
+ *         vegas   delay based: once per RTT compares the expected and the
+ *                 actual rate and steers the backlog queued in the network
+ *                 between VEGAS_ALPHA and VEGAS_BETA packets
+ *
+ *       One window cut is made per loss epoch: losses detected within an
+ *       RTT of the last cut belong to the same congestion event.
+ */
+
+
+#ifndef _RDT_CC_H_
+#define _RDT_CC_H_
+
+
+/* controllers */
+enum {CC_FIXED=0, CC_RENO, CC_VEGAS, CC_NUM};
+
+#define CC_INITIAL_WINDOW   2       /* packets, reno and vegas */
+#define VEGAS_ALPHA         1       /* backlog bounds (in packets) */
+#define VEGAS_BETA          3
+
+class CongestionControl
+{
+protected:
+    double cwnd;            /* congestion window (in packets) */
+    double max_cwnd;        /* the sender's window capacity */
+    double srtt;            /* smoothed round-trip time, 0 before a sample */
+    double epoch_end;       /* end of the current loss epoch */
+
+    /* start a loss epoch, false if the loss belongs to the running one */
+    bool new_epoch(double now);
+    void clamp();
+
+public:
+    CongestionControl(double initial, double max_cwnd);
+    virtual ~CongestionControl() {}
+
+    /* packets newly acknowledged */
+    virtual void on_ack(int packets) = 0;
+
+    /* a round-trip time sample from a packet sent once */
+    virtual void on_rtt(double rtt, double now);
+
+    /* a loss was detected, by a timeout or by a nak */
+    virtual void on_loss(bool timeout, double now) = 0;
+
+    /* packets the sender may have outstanding, at least 1 */
+    int window() const;
+};
+
+/* a controller of the given kind.  window is the size of the fixed window,
+   max_cwnd the largest window the sender can hold */
+CongestionControl *CC_Create(int kind, int window, int max_cwnd);
+
+/* controller by name ("fixed", "reno", "vegas"), -1 if there is none */
+int CC_Parse(const char *name);
+
+/* name of a controller */
+const char *CC_Name(int kind);
+
+#endif  /* _RDT_CC_H_ */
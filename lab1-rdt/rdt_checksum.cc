@@ -0,0 +1,275 @@
+/*
+ * FILE: rdt_checksum.cc
+ * DESCRIPTION: Packet checksum kernels.
+ *
+ *       The bytewise crc16 is the one from
+ *       https://github.com/lammertb/libcrc/blob/master/src/crc16.c that
+ *       utils.h used to carry; slicing-by-8 extends its table to eight
+ *       tables so that eight bytes take eight independent lookups.
+ */
+
+
+#include <string.h>
+
+#include "rdt_checksum.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAVE_X86_CRC32
+#endif
+
+
+#define CRC_POLY_16     0xA001
+#define CRC_POLY_32C    0x82F63B78
+
+static uint16_t crc16_tab[8][256];
+static uint32_t crc32c_tab[8][256];
+
+static const char *checksum_names[CSUM_NUM] = {"crc16", "crc32c"};
+static const int checksum_sizes[CSUM_NUM] = {2, 4};
+
+
+/* tab[0] is the classic bytewise table, tab[k][i] is the crc of byte i
+   followed by k zero bytes */
+template <class T>
+static void build_tables(T tab[8][256], T poly)
+{
+    for (int i=0; i<256; i++) {
+	T crc = i;
+	for (int j=0; j<8; j++)
+	    crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+	tab[0][i] = crc;
+    }
+    for (int k=1; k<8; k++)
+	for (int i=0; i<256; i++)
+	    tab[k][i] = (tab[k-1][i] >> 8) ^ tab[0][tab[k-1][i] & 0xff];
+}
+
+/* eight bytes as a little endian word */
+static inline uint64_t load64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+template <class T>
+static inline T slice8(const T tab[8][256], T crc, const unsigned char *p, size_t len)
+{
+    while (len>=8) {
+	uint64_t v = load64(p) ^ crc;
+	crc = tab[7][v & 0xff] ^ tab[6][(v >> 8) & 0xff] ^
+	    tab[5][(v >> 16) & 0xff] ^ tab[4][(v >> 24) & 0xff] ^
+	    tab[3][(v >> 32) & 0xff] ^ tab[2][(v >> 40) & 0xff] ^
+	    tab[1][(v >> 48) & 0xff] ^ tab[0][v >> 56];
+	p += 8;
+	len -= 8;
+    }
+    while (len--)
+	crc = (crc >> 8) ^ tab[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+/* N<=8 bytes as a little endian word, in whole loads: a memcpy of an odd
+   size would go through the stack and stall on store forwarding */
+template <int N>
+static inline uint64_t loadN(const unsigned char *p)
+{
+    if (N==8) return load64(p);
+    uint64_t v = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    int i = 0;
+    if (N & 4) {
+	uint32_t w;
+	memcpy(&w, p, 4);
+	v = w;
+	i = 4;
+    }
+    if (N & 2) {
+	uint16_t w;
+	memcpy(&w, p + i, 2);
+	v |= (uint64_t) w << (8*i);
+	i += 2;
+    }
+    if (N & 1)
+	v |= (uint64_t) p[i] << (8*i);
+#else
+    for (int i=0; i<N; i++)
+	v |= (uint64_t) p[i] << (8*i);
+#endif
+    return v;
+}
+
+/* N<=8 bytes in one round: byte i is followed by N-1-i more bytes */
+template <class T, int N>
+static inline T slice_short(const T tab[8][256], T crc, const unsigned char *p)
+{
+    uint64_t v = loadN<N>(p) ^ crc;
+
+    T r = N<(int)sizeof(T) ? (T)((uint64_t) crc >> (8*N)) : 0;
+#pragma GCC unroll 8
+    for (int i=0; i<N; i++)
+	r ^= tab[N-1-i][(v >> (8*i)) & 0xff];
+    return r;
+}
+
+/* the ack sizes get their own unrolled copy */
+template <class T>
+static inline T slice_upto8(const T tab[8][256], T crc, const unsigned char *p, size_t len)
+{
+    switch (len) {
+    case 3: return slice_short<T, 3>(tab, crc, p);
+    case 4: return slice_short<T, 4>(tab, crc, p);
+    case 6: return slice_short<T, 6>(tab, crc, p);
+    case 8: return slice_short<T, 8>(tab, crc, p);
+    default: return slice8<T>(tab, crc, p, len);
+    }
+}
+
+uint16_t Crc16_Bytewise(const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    uint16_t crc = 0;
+    while (len--)
+	crc = (crc >> 8) ^ crc16_tab[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+uint16_t Crc16_Slice8(const void *data, size_t len)
+{
+    return slice8<uint16_t>(crc16_tab, 0, (const unsigned char *) data, len);
+}
+
+uint32_t Crc32c_Slice8(const void *data, size_t len)
+{
+    return ~slice8<uint32_t>(crc32c_tab, 0xFFFFFFFF, (const unsigned char *) data, len);
+}
+
+#ifdef HAVE_X86_CRC32
+
+__attribute__((target("sse4.2")))
+uint32_t Crc32c_Sse42(const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    uint64_t crc = 0xFFFFFFFF;
+#ifdef __x86_64__
+    for (; len>=8; p+=8, len-=8)
+	crc = _mm_crc32_u64(crc, load64(p));
+#endif
+    uint32_t c = (uint32_t) crc;
+    for (; len>=4; p+=4, len-=4) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	c = _mm_crc32_u32(c, v);
+    }
+    while (len--)
+	c = _mm_crc32_u8(c, *p++);
+    return ~c;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42_upto8(const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+    uint32_t c = 0xFFFFFFFF;
+    if (len & 8) {
+	uint32_t v[2];
+	memcpy(v, p, 8);
+	c = _mm_crc32_u32(_mm_crc32_u32(c, v[0]), v[1]);
+	p += 8;
+    }
+    if (len & 4) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	c = _mm_crc32_u32(c, v);
+	p += 4;
+    }
+    if (len & 2) {
+	uint16_t v;
+	memcpy(&v, p, 2);
+	c = _mm_crc32_u16(c, v);
+	p += 2;
+    }
+    if (len & 1)
+	c = _mm_crc32_u8(c, *p);
+    return ~c;
+}
+
+bool Crc32c_HaveSse42()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#else
+
+uint32_t Crc32c_Sse42(const void *data, size_t len)
+{
+    return Crc32c_Slice8(data, len);
+}
+
+static uint32_t crc32c_sse42_upto8(const void *data, size_t len)
+{
+    return Crc32c_Slice8(data, len);
+}
+
+bool Crc32c_HaveSse42()
+{
+    return false;
+}
+
+#endif
+
+static uint32_t crc32c_slice8_upto8(const void *data, size_t len)
+{
+    return ~slice_upto8<uint32_t>(crc32c_tab, 0xFFFFFFFF, (const unsigned char *) data, len);
+}
+
+/* picked once before main() */
+static uint32_t (*crc32c_kernel)(const void *, size_t) = Crc32c_Slice8;
+static uint32_t (*crc32c_short)(const void *, size_t) = crc32c_slice8_upto8;
+
+static bool checksum_init()
+{
+    build_tables<uint16_t>(crc16_tab, CRC_POLY_16);
+    build_tables<uint32_t>(crc32c_tab, CRC_POLY_32C);
+    if (Crc32c_HaveSse42()) {
+	crc32c_kernel = Crc32c_Sse42;
+	crc32c_short = crc32c_sse42_upto8;
+    }
+    return true;
+}
+
+static bool checksum_ready = checksum_init();
+
+int Checksum_Size(int kind)
+{
+    return checksum_sizes[kind];
+}
+
+uint32_t Checksum(int kind, const void *data, size_t len)
+{
+    if (kind==CSUM_CRC32C) return crc32c_kernel(data, len);
+    return Crc16_Slice8(data, len);
+}
+
+uint32_t Checksum_Short(int kind, const void *data, size_t len)
+{
+    if (kind==CSUM_CRC32C) return crc32c_short(data, len);
+    return slice_upto8<uint16_t>(crc16_tab, 0, (const unsigned char *) data, len);
+}
+
+int Checksum_Parse(const char *name)
+{
+    for (int i=0; i<CSUM_NUM; i++)
+	if (strcmp(name, checksum_names[i])==0) return i;
+    return -1;
+}
+
+const char *Checksum_Name(int kind)
+{
+    if (kind<0 || kind>=CSUM_NUM) return "unknown";
+    return checksum_names[kind];
+}
@@ -0,0 +1,55 @@
+/*
+ * FILE: rdt_checksum.h
+ * DESCRIPTION: Packet checksum kernels.
+ *
+ *       crc16   CRC-16/ARC (poly 0xA001 reflected, init 0), the checksum the
+ *               rdt protocol has always used, computed eight bytes at a time
+ *               with slicing-by-8 tables.
+ *       crc32c  CRC-32C (Castagnoli, poly 0x82F63B78 reflected, init and
+ *               final xor 0xFFFFFFFF).  It catches all burst errors up to
+ *               32 bits and lets far fewer random corruptions through than
+ *               crc16.  Uses the SSE4.2 crc32 instruction when the CPU has
+ *               it, picked once at startup, and slicing-by-8 otherwise.
+ *
+ *       The tables are built before main() runs, so nothing on the packet
+ *       path checks for initialization.  Checksum_Short() is the fast path
+ *       for the few header bytes of an ack: one round of table lookups (or
+ *       crc32 instructions), no loop.
+ */
+
+
+#ifndef _RDT_CHECKSUM_H_
+#define _RDT_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* checksum kinds */
+enum {CSUM_CRC16=0, CSUM_CRC32C, CSUM_NUM};
+
+/* bytes the checksum takes in a packet header */
+int Checksum_Size(int kind);
+
+/* checksum of len bytes */
+uint32_t Checksum(int kind, const void *data, size_t len);
+
+/* the same for len<=8, used for ack headers */
+uint32_t Checksum_Short(int kind, const void *data, size_t len);
+
+/* checksum kind by name ("crc16", "crc32c"), -1 if there is none */
+int Checksum_Parse(const char *name);
+
+/* name of a checksum kind */
+const char *Checksum_Name(int kind);
+
+/* the individual kernels, for the benchmark */
+uint16_t Crc16_Bytewise(const void *data, size_t len);
+uint16_t Crc16_Slice8(const void *data, size_t len);
+uint32_t Crc32c_Slice8(const void *data, size_t len);
+uint32_t Crc32c_Sse42(const void *data, size_t len);   /* needs SSE4.2 */
+
+/* whether the CPU has the SSE4.2 crc32 instruction */
+bool Crc32c_HaveSse42();
+
+#endif  /* _RDT_CHECKSUM_H_ */
@@ -0,0 +1,86 @@
+/*
+ * FILE: rdt_config.h
+ * DESCRIPTION: Runtime configuration shared by the rdt sender and receiver.
+ *
+ *       Both sides read the same rdt_config, which the simulator fills in
+ *       from its command line before calling Sender_Init()/Receiver_Init();
+ *       that is how the two ends agree on the protocol variant.
+ */
+
+
+#ifndef _RDT_CONFIG_H_
+#define _RDT_CONFIG_H_
+
+
+/* protocol variants */
+enum {PROTO_GBN=0, PROTO_SR, PROTO_NUM};
+
+/* retransmission timeout policies */
+enum {RTO_FIXED=0, RTO_ADAPTIVE, RTO_NUM};
+
+/* loss detection by duplicate acks: none (timeouts only), fast retransmit
+   (the congestion window restarts as after a timeout), or fast retransmit
+   with fast recovery (the window is halved, and until the data sent
+   before the loss is acked every partial ack resends the next hole) */
+enum {FRTX_OFF=0, FRTX_RETRANSMIT, FRTX_RECOVERY, FRTX_NUM};
+
+/* duplicate acks that trigger a fast retransmit */
+#define DUPACK_THRESHOLD 3
+
+/* default sender buffer capacity (in packets) */
+#define SEND_BUFFER 4096
+
+/* default longest delay of an ack (in seconds) when acks are delayed */
+#define ACK_DELAY 0.05
+
+/* default longest wait of a packet that is not full (in seconds) when
+   messages are coalesced */
+#define COALESCE_DELAY 0.05
+
+struct rdt_config {
+    int protocol;           /* PROTO_GBN or PROTO_SR */
+    int rto;                /* RTO_FIXED (TIME_OUT) or RTO_ADAPTIVE */
+    int cc;                 /* congestion controller, see rdt_cc.h */
+    int header;             /* packet header version, see rdt_header.h */
+    int checksum;           /* packet checksum, see rdt_checksum.h */
+    int send_buffer;        /* sender buffer capacity (in packets), see
+                               rdt_backpressure.h */
+    bool sack;              /* acks carry SACK blocks, see rdt_header.h */
+    int ack_every;          /* ack every ack_every in-order packets, 1 acks
+                               each one right away */
+    double ack_delay;       /* a delayed ack goes out after this long at
+                               the latest (in seconds) */
+    int coalesce;           /* 0, or coalesce messages into shared packets
+                               and send once this many bytes wait, see
+                               rdt_header.h */
+    double coalesce_delay;  /* a packet that is not full goes out after
+                               this long at the latest (in seconds) */
+    int fast_rtx;           /* FRTX_OFF, FRTX_RETRANSMIT or FRTX_RECOVERY */
+    int fec;                /* forward error correction, see rdt_fec.h */
+    int fec_k;              /* data packets per FEC block */
+    int fec_m;              /* parity packets per block (rs) */
+    int connections;        /* connections over the link, see rdt_conn.h */
+};
+
+extern struct rdt_config rdt_config;
+
+/* protocol by name ("gbn", "sr"), -1 if there is no such protocol */
+int Protocol_Parse(const char *name);
+
+/* name of a protocol */
+const char *Protocol_Name(int protocol);
+
+/* timeout policy by name ("fixed", "adaptive"), -1 if there is none */
+int Rto_Parse(const char *name);
+
+/* name of a timeout policy */
+const char *Rto_Name(int rto);
+
+/* duplicate ack policy by name ("off", "retransmit", "recovery"), -1 if
+   there is none */
+int FastRtx_Parse(const char *name);
+
+/* name of a duplicate ack policy */
+const char *FastRtx_Name(int fast_rtx);
+
+#endif  /* _RDT_CONFIG_H_ */
@@ -0,0 +1,47 @@
+/*
+ * FILE: rdt_conn.h
+ * DESCRIPTION: Many rdt connections over one link.
+ *
+ *       The sender and the receiver keep the state of each connection in
+ *       a connection object of their own; rdt_config.connections of them,
+ *       with IDs 0..connections-1, are opened by Sender_Init() and
+ *       Receiver_Init().  Every packet names its connection in the header
+ *       (header v3, see rdt_header.h), so one link carries them all and
+ *       the receiving end hands each packet to its connection.
+ *
+ *       What happens at one end of a connection, its timer expiring or a
+ *       message arriving, is passed with the connection ID.  The routines
+ *       of rdt_sender.h and rdt_receiver.h that have no connection ID act
+ *       on connection 0; rdt_backpressure.h and rdt_receiver_timer.h take
+ *       one.
+ */
+
+
+#ifndef _RDT_CONN_H_
+#define _RDT_CONN_H_
+
+#include "rdt_struct.h"
+
+
+/* most connections, the IDs are 16 bits */
+#define CONN_MAX 65536
+
+/* implemented by the simulator: the timer routines of rdt_sender.h for a
+   connection, every connection has a timer of its own */
+void Sender_StartConnTimer(int conn, double timeout);
+void Sender_StopConnTimer(int conn);
+bool Sender_isConnTimerSet(int conn);
+
+/* implemented by the sender: the timer of a connection expired */
+void Sender_ConnTimeout(int conn);
+
+/* implemented by the simulator: deliver a message of a connection to the
+   upper layer at the receiver */
+void Receiver_ConnToUpperLayer(int conn, struct message *msg);
+
+/* implemented by the sender and the receiver: bytes allocated for the
+   state of all their connections, the messages queued in them aside */
+long long Sender_ConnMemory();
+long long Receiver_ConnMemory();
+
+#endif  /* _RDT_CONN_H_ */
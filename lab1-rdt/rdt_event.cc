@@ -0,0 +1,293 @@
+/*
+ * FILE: rdt_event.cc
+ * DESCRIPTION: Scheduler backends of the simulation event chain.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "rdt_event.h"
+
+
+thread_local struct event_pool_stats event_pool_stats = {0, 0};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  sorted linked list
+  []------------------------------------------------------------------------[]*/
+
+void ListQueue::push(Event *e)
+{
+    Event **ppcur = &head;
+    while ((*ppcur!=NULL) && !event_before(e, *ppcur))
+	ppcur = &((*ppcur)->next);
+
+    e->next = *ppcur;
+    *ppcur = e;
+    count++;
+}
+
+void ListQueue::remove(Event *e)
+{
+    Event **ppcur = &head;
+    while ((*ppcur!=NULL) && (*ppcur!=e))
+	ppcur = &((*ppcur)->next);
+
+    if (*ppcur==e) {
+	*ppcur = e->next;
+	count--;
+    }
+}
+
+Event *ListQueue::pop()
+{
+    if (head==NULL) return NULL;
+
+    Event *e = head;
+    head = head->next;
+    count--;
+
+    return e;
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  D-ary heap
+  []------------------------------------------------------------------------[]*/
+
+template <int D>
+void HeapQueue<D>::sift_up(size_t i)
+{
+    Event *e = heap[i];
+    while (i>0) {
+	size_t parent = (i-1)/D;
+	if (!event_before(e, heap[parent])) break;
+	place(heap[parent], i);
+	i = parent;
+    }
+    place(e, i);
+}
+
+template <int D>
+void HeapQueue<D>::sift_down(size_t i)
+{
+    Event *e = heap[i];
+    size_t n = heap.size();
+    for (;;) {
+	size_t first = i*D + 1;
+	if (first>=n) break;
+
+	/* find the earliest child */
+	size_t last = std::min(first + D, n);
+	size_t best = first;
+	for (size_t c=first+1; c<last; c++)
+	    if (event_before(heap[c], heap[best])) best = c;
+
+	if (!event_before(heap[best], e)) break;
+	place(heap[best], i);
+	i = best;
+    }
+    place(e, i);
+}
+
+template <int D>
+void HeapQueue<D>::push(Event *e)
+{
+    heap.push_back(e);
+    sift_up(heap.size()-1);
+}
+
+template <int D>
+void HeapQueue<D>::remove(Event *e)
+{
+    size_t i = (size_t) e->qpos;
+    if (e->qpos<0 || i>=heap.size() || heap[i]!=e) return;
+
+    Event *last = heap.back();
+    heap.pop_back();
+    e->qpos = -1;
+    if (last==e) return;
+
+    /* the former last event fills the hole and moves whichever way it must */
+    place(last, i);
+    if (i>0 && event_before(last, heap[(i-1)/D]))
+	sift_up(i);
+    else
+	sift_down(i);
+}
+
+template <int D>
+Event *HeapQueue<D>::pop()
+{
+    if (heap.empty()) return NULL;
+
+    Event *e = heap[0];
+    Event *last = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+	place(last, 0);
+	sift_down(0);
+    }
+    e->qpos = -1;
+
+    return e;
+}
+
+template class HeapQueue<2>;
+template class HeapQueue<4>;
+
+
+/*[]------------------------------------------------------------------------[]
+  |  calendar queue
+  []------------------------------------------------------------------------[]*/
+
+/* number of events sampled to estimate the bucket width on a resize */
+#define CALENDAR_SAMPLES 25
+
+CalendarQueue::CalendarQueue()
+{
+    buckets.assign(2, NULL);
+    mask = 1;
+    width = 1.0;
+    cur = 0;
+    count = 0;
+}
+
+/* link an event into its bucket, keeping the bucket sorted */
+void CalendarQueue::insert(Event *e)
+{
+    size_t b = (size_t) day(e->sched_time) & mask;
+    Event **ppcur = &buckets[b];
+    while ((*ppcur!=NULL) && !event_before(e, *ppcur))
+	ppcur = &((*ppcur)->next);
+
+    e->next = *ppcur;
+    *ppcur = e;
+    e->qpos = (int) b;
+}
+
+/* rebuild the calendar with nbuckets buckets, re-estimating the bucket width
+   as three times the average separation of the earliest events */
+void CalendarQueue::resize(size_t nbuckets)
+{
+    std::vector<Event *> all;
+    all.reserve(count);
+    for (size_t b=0; b<buckets.size(); b++)
+	for (Event *e=buckets[b]; e!=NULL; e=e->next)
+	    all.push_back(e);
+
+    double now = width * cur;
+    if (all.size()>=2) {
+	size_t nsample = std::min(all.size(), (size_t) CALENDAR_SAMPLES);
+	std::nth_element(all.begin(), all.begin() + (nsample-1), all.end(),
+			 event_before);
+	std::sort(all.begin(), all.begin() + nsample, event_before);
+	double span = all[nsample-1]->sched_time - all[0]->sched_time;
+	if (span>0) width = 3.0 * span / (nsample-1);
+    }
+
+    if (!all.empty()) now = std::min(now, all[0]->sched_time);
+
+    buckets.assign(nbuckets, NULL);
+    mask = nbuckets - 1;
+    cur = day(now);
+    for (size_t i=0; i<all.size(); i++)
+	insert(all[i]);
+}
+
+void CalendarQueue::push(Event *e)
+{
+    /* an event may never land before the day being served */
+    if (day(e->sched_time)<cur) cur = day(e->sched_time);
+
+    insert(e);
+    count++;
+    if (count>2*buckets.size())
+	resize(2*buckets.size());
+}
+
+void CalendarQueue::remove(Event *e)
+{
+    if (e->qpos<0 || (size_t) e->qpos>=buckets.size()) return;
+
+    Event **ppcur = &buckets[e->qpos];
+    while ((*ppcur!=NULL) && (*ppcur!=e))
+	ppcur = &((*ppcur)->next);
+    if (*ppcur!=e) return;
+
+    *ppcur = e->next;
+    e->qpos = -1;
+    count--;
+}
+
+Event *CalendarQueue::top()
+{
+    if (count==0) return NULL;
+
+    /* walk one year of buckets looking for an event due on its day */
+    Event *e = NULL;
+    for (size_t n=0; n<=mask; n++, cur++) {
+	Event *head = buckets[(size_t) cur & mask];
+	if (head!=NULL && day(head->sched_time)<=cur) {
+	    e = head;
+	    break;
+	}
+    }
+
+    /* the calendar is sparse, jump straight to the earliest event */
+    if (e==NULL) {
+	for (size_t b=0; b<=mask; b++)
+	    if (buckets[b]!=NULL && (e==NULL || event_before(buckets[b], e)))
+		e = buckets[b];
+	cur = day(e->sched_time);
+    }
+
+    return e;
+}
+
+Event *CalendarQueue::pop()
+{
+    Event *e = top();
+    if (e==NULL) return NULL;
+
+    buckets[e->qpos] = e->next;
+    e->qpos = -1;
+    count--;
+    if (buckets.size()>2 && count<buckets.size()/2)
+	resize(buckets.size()/2);
+
+    return e;
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  backend selection
+  []------------------------------------------------------------------------[]*/
+
+static const char *sched_names[SCHED_NUM] = {"list", "heap2", "heap4", "calendar"};
+
+EventQueue *EventQueue_Create(int kind)
+{
+    switch (kind) {
+    case SCHED_LIST:     return new ListQueue;
+    case SCHED_HEAP2:    return new HeapQueue<2>;
+    case SCHED_CALENDAR: return new CalendarQueue;
+    default:             return new HeapQueue<4>;
+    }
+}
+
+int EventQueue_Parse(const char *name)
+{
+    for (int i=0; i<SCHED_NUM; i++)
+	if (strcmp(name, sched_names[i])==0) return i;
+    return -1;
+}
+
+const char *EventQueue_Name(int kind)
+{
+    if (kind<0 || kind>=SCHED_NUM) return "unknown";
+    return sched_names[kind];
+}
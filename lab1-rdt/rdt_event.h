@@ -0,0 +1,291 @@
+/*
+ * FILE: rdt_event.h
+ * DESCRIPTION: The generic event chain framework of the simulator.
+ *
+ *       The event chain keeps pending events ordered by sched_time; events
+ *       scheduled for the same time fire in the order they were scheduled,
+ *       the earlier scheduling time first.
+ *       The ordering itself is delegated to a pluggable scheduler backend:
+ *
+ *         list      the original sorted singly linked list, O(n) insert
+ *         heap2     binary heap, O(log n) insert/cancel/next
+ *         heap4     4-ary heap, O(log n) with shallower trees (default)
+ *         calendar  calendar queue (R. Brown, CACM 1988), O(1) amortized
+ */
+
+
+#ifndef _RDT_EVENT_H_
+#define _RDT_EVENT_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+
+/* simulation event base class */
+class Event
+{
+public:
+    double sched_time;      /* scheduled occuring time */
+    int event_type;         /* application-specific event type */
+    class Event *next;      /* next event in the chain */
+    double created;         /* simulation time it was scheduled at */
+    unsigned long long seq; /* scheduling order, breaks ties on created */
+    int qpos;               /* backend bookkeeping, -1 when not scheduled */
+
+public:
+    Event() { next = NULL; created = 0; seq = 0; qpos = -1; }
+    virtual ~Event() {}
+};
+
+/* the total order of the event chain: earlier sched_time first, and
+   first-scheduled first among events happening at the same time */
+static inline bool event_before(const Event *a, const Event *b)
+{
+    if (a->sched_time != b->sched_time) return a->sched_time < b->sched_time;
+    if (a->created != b->created) return a->created < b->created;
+    return a->seq < b->seq;
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  event pools
+  []------------------------------------------------------------------------[]*/
+
+/* number of events carved out of one slab */
+#define EVENT_POOL_SLAB 64
+
+/* allocation statistics shared by all event pools of a thread */
+struct event_pool_stats {
+    unsigned long long allocs;  /* events handed out */
+    unsigned long long slabs;   /* heap allocations made to grow the pools */
+};
+extern thread_local struct event_pool_stats event_pool_stats;
+
+/* typed free-list pool: freed events go back onto the list of their own type
+   and are reused by the next allocation, so the pool only touches the heap
+   while the number of live events of type T is still growing.  slabs are
+   kept until the process exits.  every thread has its own lists, so an
+   event should be freed by the thread that allocated it */
+template <class T>
+class EventPool
+{
+    union Slot {
+	Slot *next;
+	alignas(T) char obj[sizeof(T)];
+    };
+    static thread_local Slot *free_list;
+
+    static void grow() {
+	Slot *slab = (Slot *) malloc(sizeof(Slot) * EVENT_POOL_SLAB);
+	if (slab==NULL) throw std::bad_alloc();
+	for (int i=0; i<EVENT_POOL_SLAB-1; i++)
+	    slab[i].next = &slab[i+1];
+	slab[EVENT_POOL_SLAB-1].next = free_list;
+	free_list = slab;
+	event_pool_stats.slabs++;
+    }
+
+public:
+    static void *alloc() {
+	if (free_list==NULL) grow();
+	Slot *s = free_list;
+	free_list = s->next;
+	event_pool_stats.allocs++;
+	return s;
+    }
+
+    static void release(void *p) {
+	Slot *s = (Slot *) p;
+	s->next = free_list;
+	free_list = s;
+    }
+};
+
+template <class T>
+thread_local typename EventPool<T>::Slot *EventPool<T>::free_list = NULL;
+
+/* base class of events allocated from their own pool: new and delete of a
+   T (or of an Event pointing at one) go through EventPool<T> */
+template <class T>
+class PooledEvent : public Event
+{
+public:
+    static void *operator new(size_t size) {
+	if (size!=sizeof(T)) return ::operator new(size);
+	return EventPool<T>::alloc();
+    }
+
+    static void operator delete(void *p, size_t size) {
+	if (p==NULL) return;
+	if (size!=sizeof(T)) ::operator delete(p);
+	else EventPool<T>::release(p);
+    }
+};
+
+
+/*[]------------------------------------------------------------------------[]
+  |  scheduler backends
+  []------------------------------------------------------------------------[]*/
+
+enum {SCHED_LIST=0, SCHED_HEAP2, SCHED_HEAP4, SCHED_CALENDAR, SCHED_NUM};
+
+/* a priority queue of events ordered by event_before() */
+class EventQueue
+{
+public:
+    virtual ~EventQueue() {}
+
+    /* insert an event that is not in the queue */
+    virtual void push(Event *e) = 0;
+    /* remove an event, do nothing if it is not in the queue */
+    virtual void remove(Event *e) = 0;
+    /* remove and return the first event, NULL if the queue is empty */
+    virtual Event *pop() = 0;
+    /* the first event without removing it, NULL if the queue is empty */
+    virtual Event *top() = 0;
+    /* number of events in the queue */
+    virtual size_t size() = 0;
+};
+
+/* the original sorted singly linked list */
+class ListQueue : public EventQueue
+{
+    Event *head;
+    size_t count;
+
+public:
+    ListQueue() { head = NULL; count = 0; }
+    void push(Event *e);
+    void remove(Event *e);
+    Event *pop();
+    Event *top() { return head; }
+    size_t size() { return count; }
+};
+
+/* implicit D-ary min-heap, every event remembers its slot in qpos so that
+   it can be cancelled without a search */
+template <int D>
+class HeapQueue : public EventQueue
+{
+    std::vector<Event *> heap;
+
+    void place(Event *e, size_t i) { heap[i] = e; e->qpos = (int) i; }
+    void sift_up(size_t i);
+    void sift_down(size_t i);
+
+public:
+    void push(Event *e);
+    void remove(Event *e);
+    Event *pop();
+    Event *top() { return heap.empty() ? NULL : heap[0]; }
+    size_t size() { return heap.size(); }
+};
+
+/* calendar queue: a year of nbuckets days, each day a sorted list of the
+   events falling into it.  the calendar is resized (and the day width
+   re-estimated) whenever the population doubles or halves.  qpos holds the
+   bucket of a scheduled event */
+class CalendarQueue : public EventQueue
+{
+    std::vector<Event *> buckets;
+    size_t mask;            /* nbuckets - 1, nbuckets is a power of two */
+    double width;           /* time span of one bucket */
+    long long cur;          /* current virtual bucket (day since time 0) */
+    size_t count;
+
+    long long day(double t) { return (long long)(t / width); }
+    void insert(Event *e);
+    void resize(size_t nbuckets);
+
+public:
+    CalendarQueue();
+    void push(Event *e);
+    void remove(Event *e);
+    Event *pop();
+    Event *top();
+    size_t size() { return count; }
+};
+
+/* create a scheduler backend of the given kind */
+EventQueue *EventQueue_Create(int kind);
+
+/* backend kind by name, -1 if there is no such backend */
+int EventQueue_Parse(const char *name);
+
+/* name of a backend kind */
+const char *EventQueue_Name(int kind);
+
+
+/*[]------------------------------------------------------------------------[]
+  |  event chain
+  []------------------------------------------------------------------------[]*/
+
+/* event chain class - the simulation core */
+class EventChain
+{
+public:
+    double sim_time;        /* simulation time */
+    EventQueue *queue;      /* pending events */
+    unsigned long long nscheduled;  /* number of schedule() calls so far */
+
+public:
+    EventChain(int kind = SCHED_HEAP4) {
+	sim_time = 0;
+	nscheduled = 0;
+	queue = EventQueue_Create(kind);
+    }
+    ~EventChain() { delete queue; }
+
+    /* switch to another scheduler backend, only allowed while no event is
+       scheduled */
+    void set_backend(int kind) {
+	if (queue->size()!=0) return;
+	delete queue;
+	queue = EventQueue_Create(kind);
+    }
+
+    double time() { return sim_time; }
+
+    /* schedule an event - events are delivered on an increasing order of
+       sched_time */
+    void schedule(Event *e) {
+	/* do nothing if the event is schedule for the past */
+	if (e->sched_time<sim_time) return;
+
+	e->created = sim_time;
+	e->seq = nscheduled++;
+	queue->push(e);
+    }
+
+    /* schedule an event scheduled at time created, possibly by another
+       chain, with a tie-breaking order of the caller's own: of the events
+       scheduled for the same time at the same time, the one with the
+       smaller seq happens first */
+    void schedule(Event *e, double created, unsigned long long seq) {
+	if (e->sched_time<sim_time) return;
+
+	e->created = created;
+	e->seq = seq;
+	nscheduled++;
+	queue->push(e);
+    }
+
+    /* cancel an event scheduled for happening in the future */
+    void cancel(Event *e) { queue->remove(e); }
+
+    /* the next event without advancing to it, NULL if there is none */
+    Event *peek() { return queue->top(); }
+
+    /* advance to the next event */
+    Event *next_event() {
+	Event *e = queue->pop();
+	if (e==NULL) return NULL;
+
+	sim_time = e->sched_time;
+	return e;
+    }
+};
+
+#endif  /* _RDT_EVENT_H_ */
@@ -0,0 +1,153 @@
+/*
+ * FILE: rdt_fec.cc
+ * DESCRIPTION: Forward error correction codes of the rdt protocol.
+ *
+ *       GF(256) uses the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d), in
+ *       which 2 generates the multiplicative group.  A full 256x256
+ *       product table turns the inner loops into one lookup per byte.
+ */
+
+
+#include <string.h>
+
+#include "rdt_fec.h"
+
+
+#define GF_POLY 0x11d
+
+static unsigned char gf_exp[512];
+static unsigned char gf_log[256];
+static unsigned char gf_mul[256][256];
+
+static const char *fec_names[FEC_NUM] = {"off", "xor", "rs"};
+
+
+static bool fec_init()
+{
+    int x = 1;
+    for (int i=0; i<255; i++) {
+	gf_exp[i] = gf_exp[i + 255] = (unsigned char) x;
+	gf_log[x] = (unsigned char) i;
+	x <<= 1;
+	if (x & 0x100) x ^= GF_POLY;
+    }
+    for (int a=1; a<256; a++)
+	for (int b=1; b<256; b++)
+	    gf_mul[a][b] = gf_exp[gf_log[a] + gf_log[b]];
+    return true;
+}
+
+static bool fec_ready = fec_init();
+
+static inline unsigned char gf_inv(unsigned char a)
+{
+    return gf_exp[255 - gf_log[a]];
+}
+
+/* the coefficient of data symbol i in parity symbol j */
+static inline unsigned char coef(int kind, int m, int j, int i)
+{
+    if (kind==FEC_XOR) return 1;
+    return gf_inv((unsigned char)(j ^ (m + i)));
+}
+
+/* dst += c * src */
+static inline void mul_add(unsigned char *dst, const unsigned char *src, unsigned char c,
+			   int len)
+{
+    if (c==0) return;
+    if (c==1) {
+	for (int b=0; b<len; b++) dst[b] ^= src[b];
+	return;
+    }
+    const unsigned char *row = gf_mul[c];
+    for (int b=0; b<len; b++) dst[b] ^= row[src[b]];
+}
+
+int Fec_Parities(int kind, int m)
+{
+    if (kind==FEC_OFF) return 0;
+    return kind==FEC_XOR ? 1 : m;
+}
+
+void Fec_Add(int kind, int m, int i, const unsigned char *sym, int len,
+	     unsigned char *parity)
+{
+    int n = Fec_Parities(kind, m);
+    for (int j=0; j<n; j++)
+	mul_add(parity + j*len, sym, coef(kind, n, j, i), len);
+}
+
+bool Fec_Decode(int kind, int k, int m, unsigned char **data, const bool *have,
+		unsigned char *const *parity, const bool *have_parity, int len)
+{
+    int n = Fec_Parities(kind, m);
+    int missing[FEC_MAX_BLOCK], rows[FEC_MAX_BLOCK];
+    int e = 0, r = 0;
+    for (int i=0; i<k; i++)
+	if (!have[i]) missing[e++] = i;
+    if (e==0) return true;
+    for (int j=0; j<n && r<e; j++)
+	if (have_parity[j]) rows[r++] = j;
+    if (r<e) return false;
+
+    /* the system a * missing = syndromes, a[x][y] = C[rows[x]][missing[y]],
+       inverted by Gauss-Jordan elimination alongside the identity */
+    unsigned char a[FEC_MAX_BLOCK][FEC_MAX_BLOCK], inv[FEC_MAX_BLOCK][FEC_MAX_BLOCK];
+    for (int x=0; x<e; x++)
+	for (int y=0; y<e; y++) {
+	    a[x][y] = coef(kind, n, rows[x], missing[y]);
+	    inv[x][y] = x==y;
+	}
+    for (int c=0; c<e; c++) {
+	int p = c;
+	while (p<e && a[p][c]==0) p++;
+	if (p==e) return false;     /* cannot happen with a Cauchy matrix */
+	if (p!=c) {
+	    for (int y=0; y<e; y++) {
+		unsigned char t = a[c][y]; a[c][y] = a[p][y]; a[p][y] = t;
+		t = inv[c][y]; inv[c][y] = inv[p][y]; inv[p][y] = t;
+	    }
+	}
+	unsigned char s = gf_inv(a[c][c]);
+	for (int y=0; y<e; y++) {
+	    a[c][y] = gf_mul[s][a[c][y]];
+	    inv[c][y] = gf_mul[s][inv[c][y]];
+	}
+	for (int x=0; x<e; x++) {
+	    unsigned char f = a[x][c];
+	    if (x==c || f==0) continue;
+	    for (int y=0; y<e; y++) {
+		a[x][y] ^= gf_mul[f][a[c][y]];
+		inv[x][y] ^= gf_mul[f][inv[c][y]];
+	    }
+	}
+    }
+
+    /* syndromes: the parity rows with the symbols present taken out */
+    unsigned char syn[FEC_MAX_BLOCK][256];
+    for (int x=0; x<e; x++) {
+	memcpy(syn[x], parity[rows[x]], len);
+	for (int i=0; i<k; i++)
+	    if (have[i]) mul_add(syn[x], data[i], coef(kind, n, rows[x], i), len);
+    }
+    for (int y=0; y<e; y++) {
+	memset(data[missing[y]], 0, len);
+	for (int x=0; x<e; x++)
+	    mul_add(data[missing[y]], syn[x], inv[y][x], len);
+    }
+    return true;
+}
+
+int Fec_Parse(const char *name)
+{
+    for (int i=0; i<FEC_NUM; i++)
+	if (strcmp(name, fec_names[i])==0) return i;
+    return -1;
+}
+
+const char *Fec_Name(int kind)
+{
+    if (kind<0 || kind>=FEC_NUM) return "unknown";
+    return fec_names[kind];
+}
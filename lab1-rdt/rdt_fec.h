@@ -0,0 +1,59 @@
+/*
+ * FILE: rdt_fec.h
+ * DESCRIPTION: Forward error correction codes of the rdt protocol.
+ *
+ *       The sender groups its data packets into blocks of k and sends m
+ *       parity packets after each block; the receiver rebuilds up to m
+ *       lost packets of a block from the ones it has and the parity,
+ *       without waiting for a retransmission.  Codes work on symbols of
+ *       equal length, a data packet's size byte and padded payload:
+ *
+ *         xor     one parity symbol, the xor of the block; rebuilds a
+ *                 single loss
+ *         rs      Reed-Solomon over GF(256) with a Cauchy matrix: parity j
+ *                 is sum C[j][i] * data i with C[j][i] = 1 / (j + m + i),
+ *                 adding being xor.  Every square submatrix of a Cauchy
+ *                 matrix is invertible, so any m of the k + m symbols of a
+ *                 block can be lost
+ *
+ *       The multiplication tables are built before main() runs, like the
+ *       checksum tables.
+ */
+
+
+#ifndef _RDT_FEC_H_
+#define _RDT_FEC_H_
+
+
+/* codes */
+enum {FEC_OFF=0, FEC_XOR, FEC_RS, FEC_NUM};
+
+/* default block size and parity packets per block (rs) */
+#define FEC_K       4
+#define FEC_M       2
+
+/* largest block, k + m may not exceed it */
+#define FEC_MAX_BLOCK 64
+
+/* parity symbols per block: 1 for xor, m for rs */
+int Fec_Parities(int kind, int m);
+
+/* add data symbol i (0..k-1) of a block to its m parity symbols, which
+   lie one after the other in parity and start out zeroed.  symbols are at
+   most 256 bytes */
+void Fec_Add(int kind, int m, int i, const unsigned char *sym, int len,
+             unsigned char *parity);
+
+/* rebuild the missing data symbols of a block in place.  data[i] is
+   symbol i, present if have[i]; parity[j] likewise if have_parity[j].
+   false, leaving data alone, if more are missing than parity present */
+bool Fec_Decode(int kind, int k, int m, unsigned char **data, const bool *have,
+                unsigned char *const *parity, const bool *have_parity, int len);
+
+/* code by name ("off", "xor", "rs"), -1 if there is none */
+int Fec_Parse(const char *name);
+
+/* name of a code */
+const char *Fec_Name(int kind);
+
+#endif  /* _RDT_FEC_H_ */
@@ -0,0 +1,259 @@
+/*
+ * FILE: rdt_header.cc
+ * DESCRIPTION: Versioned packet header formats of the rdt protocol.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdt_header.h"
+
+
+#define HDR_EXTENDED 0x80   /* marks a v2+ header in the size/kind byte */
+#define ACK_SACK 0x40       /* SACK blocks follow the ack header */
+
+static const struct hdr_format formats[HDR_NUM][CSUM_NUM] = {
+    {},
+    {{HDR_V1, CSUM_CRC16, 2, 128, 64, 4, RDT_PKTSIZE - 4, 3, 5},
+     {HDR_V1, CSUM_CRC32C, 4, 128, 64, 6, RDT_PKTSIZE - 6, 3, 7}},
+    {{HDR_V2, CSUM_CRC16, 2, 65536, 32768, 6, RDT_PKTSIZE - 6, 6, 7},
+     {HDR_V2, CSUM_CRC32C, 4, 65536, 32768, 8, RDT_PKTSIZE - 8, 6, 9}},
+    {{HDR_V3, CSUM_CRC16, 2, 65536, 32768, 8, RDT_PKTSIZE - 8, 8, 9},
+     {HDR_V3, CSUM_CRC32C, 4, 65536, 32768, 10, RDT_PKTSIZE - 10, 8, 11}},
+};
+
+static const char *header_names[HDR_NUM] = {NULL, "v1", "v2", "v3"};
+
+
+static inline void put16(char *p, seq_nr_t v)
+{
+    p[0] = (char)(v & 0xff);
+    p[1] = (char)((v >> 8) & 0xff);
+}
+
+static inline seq_nr_t get16(const char *p)
+{
+    return (unsigned char) p[0] | ((seq_nr_t)(unsigned char) p[1] << 8);
+}
+
+/* bytes of the connection ID, which follows the version byte */
+static inline int conn_width(const struct hdr_format *f)
+{
+    return f->version>=HDR_V3 ? 2 : 0;
+}
+
+/* the checksum is stored little endian in the first csum_size bytes */
+static inline void put_checksum(const struct hdr_format *f, struct packet *pkt,
+				uint32_t checksum)
+{
+    for (int i=0; i<f->csum_size; i++)
+	pkt->data[i] = (char)(checksum >> (8*i));
+}
+
+static inline bool checksum_ok(const struct hdr_format *f, const struct packet *pkt,
+			       uint32_t checksum)
+{
+    for (int i=0; i<f->csum_size; i++)
+	if ((unsigned char) pkt->data[i]!=((checksum >> (8*i)) & 0xff)) return false;
+    return true;
+}
+
+const struct hdr_format *Header_Format(int version, int checksum)
+{
+    if (version<HDR_V1 || version>=HDR_NUM) return NULL;
+    if (checksum<0 || checksum>=CSUM_NUM) return NULL;
+    return &formats[version][checksum];
+}
+
+void Header_PutData(const struct hdr_format *f, struct packet *pkt,
+		    const struct data_header *h)
+{
+    char *b = pkt->data + f->csum_size;
+    if (f->version==HDR_V1) {
+	b[0] = (char) h->size;
+	b[1] = (char)(h->seq | (h->last ? 0x80 : 0));
+    }
+    else {
+	b[0] = (char)(HDR_EXTENDED | h->size);
+	b[1] = (char)(f->version << 4 | (h->last ? 1 : 0));
+	if (conn_width(f)) put16(b + 2, h->conn);
+	put16(b + 2 + conn_width(f), h->seq);
+    }
+    put_checksum(f, pkt, Checksum(f->checksum, b, f->data_header - f->csum_size + h->size));
+}
+
+bool Header_GetData(const struct hdr_format *f, const struct packet *pkt,
+		    struct data_header *h)
+{
+    const char *b = pkt->data + f->csum_size;
+    unsigned char b0 = (unsigned char) b[0];
+    unsigned char b1 = (unsigned char) b[1];
+
+    h->conn = 0;
+    if (f->version==HDR_V1) {
+	if (b0 & HDR_EXTENDED) return false;
+	h->size = b0;
+	h->seq = b1 & 0x7f;
+	h->last = (b1 & 0x80)!=0;
+    }
+    else {
+	if (!(b0 & HDR_EXTENDED) || (b1 >> 4)!=f->version) return false;
+	h->size = b0 & ~HDR_EXTENDED;
+	if (conn_width(f)) h->conn = get16(b + 2);
+	h->seq = get16(b + 2 + conn_width(f));
+	h->last = (b1 & 1)!=0;
+    }
+    /* a corrupted size could make the checksum read past the packet */
+    if (h->size<=0 || h->size>f->max_payload) return false;
+    return checksum_ok(f, pkt, Checksum(f->checksum, b, f->data_header - f->csum_size + h->size));
+}
+
+/* bytes of a sequence number in the SACK blocks */
+static inline int sack_width(const struct hdr_format *f)
+{
+    return f->version==HDR_V1 ? 1 : 2;
+}
+
+void Header_PutAck(const struct hdr_format *f, struct packet *pkt,
+		   const struct ack_header *h)
+{
+    char *b = pkt->data + f->csum_size;
+    int sack = h->nsack>0 ? ACK_SACK : 0;
+    if (f->version==HDR_V1) {
+	b[0] = (char)(h->kind | sack);
+	b[1] = (char) h->seq;
+	b[2] = (char) h->cumack;
+    }
+    else {
+	b[0] = (char)(HDR_EXTENDED | h->kind | sack);
+	b[1] = (char)(f->version << 4);
+	if (conn_width(f)) put16(b + 2, h->conn);
+	put16(b + 2 + conn_width(f), h->seq);
+	put16(b + 4 + conn_width(f), h->cumack);
+    }
+    if (!sack) {
+	put_checksum(f, pkt, Checksum_Short(f->checksum, b, f->ack_size));
+	return;
+    }
+
+    ASSERT(h->nsack<=SACK_MAX_BLOCKS);
+    char *p = b + f->ack_size;
+    *p++ = (char) h->nsack;
+    for (int i=0; i<h->nsack; i++) {
+	if (sack_width(f)==1) {
+	    p[0] = (char) h->sack[i].start;
+	    p[1] = (char) h->sack[i].end;
+	}
+	else {
+	    put16(p, h->sack[i].start);
+	    put16(p + 2, h->sack[i].end);
+	}
+	p += 2*sack_width(f);
+    }
+    put_checksum(f, pkt, Checksum(f->checksum, b, p - b));
+}
+
+bool Header_GetAck(const struct hdr_format *f, const struct packet *pkt,
+		   struct ack_header *h)
+{
+    /* a plain ack is only its header, so the short checksum covers it all.
+       the block count is checked before it sizes the checksum, like the
+       payload size of a data packet */
+    const char *b = pkt->data + f->csum_size;
+    unsigned char b0 = (unsigned char) b[0];
+    unsigned char b1 = (unsigned char) b[1];
+    h->nsack = 0;
+    if (b0 & ACK_SACK) {
+	h->nsack = (unsigned char) b[f->ack_size];
+	if (h->nsack<=0 || h->nsack>SACK_MAX_BLOCKS) return false;
+	int len = f->ack_size + 1 + 2*sack_width(f)*h->nsack;
+	if (!checksum_ok(f, pkt, Checksum(f->checksum, b, len))) return false;
+	b0 &= ~ACK_SACK;
+    }
+    else if (!checksum_ok(f, pkt, Checksum_Short(f->checksum, b, f->ack_size)))
+	return false;
+
+    h->conn = 0;
+    if (f->version==HDR_V1) {
+	if (b0 & HDR_EXTENDED) return false;
+	h->kind = b0;
+	h->seq = b1 & 0x7f;
+	h->cumack = (unsigned char) b[2] & 0x7f;
+    }
+    else {
+	if (!(b0 & HDR_EXTENDED) || (b1 >> 4)!=f->version) return false;
+	h->kind = b0 & ~HDR_EXTENDED;
+	if (conn_width(f)) h->conn = get16(b + 2);
+	h->seq = get16(b + 2 + conn_width(f));
+	h->cumack = get16(b + 4 + conn_width(f));
+    }
+
+    const char *p = b + f->ack_size + 1;
+    for (int i=0; i<h->nsack; i++) {
+	if (sack_width(f)==1) {
+	    h->sack[i].start = (unsigned char) p[0] & 0x7f;
+	    h->sack[i].end = (unsigned char) p[1] & 0x7f;
+	}
+	else {
+	    h->sack[i].start = get16(p);
+	    h->sack[i].end = get16(p + 2);
+	}
+	p += 2*sack_width(f);
+    }
+    return true;
+}
+
+void Header_PutParity(const struct hdr_format *f, struct packet *pkt,
+		      const struct parity_header *h)
+{
+    char *b = pkt->data + f->csum_size;
+    if (f->version==HDR_V1) {
+	b[0] = 0;
+	b[1] = (char) h->first;
+	b[2] = (char) h->index;
+    }
+    else {
+	b[0] = (char) HDR_EXTENDED;
+	b[1] = (char)(f->version << 4);
+	if (conn_width(f)) put16(b + 2, h->conn);
+	put16(b + 2 + conn_width(f), h->first);
+	b[4 + conn_width(f)] = (char) h->index;
+    }
+    put_checksum(f, pkt, Checksum(f->checksum, b, RDT_PKTSIZE - f->csum_size));
+}
+
+bool Header_GetParity(const struct hdr_format *f, const struct packet *pkt,
+		      struct parity_header *h)
+{
+    const char *b = pkt->data + f->csum_size;
+    unsigned char b0 = (unsigned char) b[0];
+    unsigned char b1 = (unsigned char) b[1];
+    h->conn = 0;
+    if (f->version==HDR_V1) {
+	if (b0!=0) return false;
+	h->first = b1 & 0x7f;
+	h->index = (unsigned char) b[2];
+    }
+    else {
+	if (b0!=HDR_EXTENDED || (b1 >> 4)!=f->version) return false;
+	if (conn_width(f)) h->conn = get16(b + 2);
+	h->first = get16(b + 2 + conn_width(f));
+	h->index = (unsigned char) b[4 + conn_width(f)];
+    }
+    return checksum_ok(f, pkt, Checksum(f->checksum, b, RDT_PKTSIZE - f->csum_size));
+}
+
+int Header_Parse(const char *name)
+{
+    for (int i=HDR_V1; i<HDR_NUM; i++)
+	if (strcmp(name, header_names[i])==0) return i;
+    return -1;
+}
+
+const char *Header_Name(int version)
+{
+    if (version<HDR_V1 || version>=HDR_NUM) return "unknown";
+    return header_names[version];
+}
@@ -0,0 +1,174 @@
+/*
+ * FILE: rdt_header.h
+ * DESCRIPTION: Versioned packet header formats of the rdt protocol.
+ *
+ *       v1, the original format with 7-bit sequence numbers:
+ *
+ *         data |<- checksum 2 ->| size 1 | last<<7 | seq 1 |<- payload ->|
+ *         ack  |<- checksum 2 ->| kind 1 | seq 1 | cumack 1 |
+ *
+ *       v2, 16-bit sequence numbers for large windows:
+ *
+ *         data |<- checksum 2 ->| 0x80 | size 1 | 2<<4 | last 1 | seq 2 |
+ *              |<- payload ->|
+ *         ack  |<- checksum 2 ->| 0x80 | kind 1 | 2<<4 1 | seq 2 | cumack 2 |
+ *
+ *       v3, v2 with a connection ID (rdt_conn.h) after the version byte,
+ *       so that many connections can share the link:
+ *
+ *         data |<- checksum 2 ->| 0x80 | size 1 | 3<<4 | last 1 | conn 2 |
+ *              | seq 2 |<- payload ->|
+ *         ack  |<- checksum 2 ->| 0x80 | kind 1 | 3<<4 1 | conn 2 | seq 2 |
+ *              | cumack 2 |
+ *
+ *       With rdt_config.sack an ack may carry SACK blocks, the ranges of
+ *       packets the receiver holds beyond the cumulative ack.  Bit 0x40 of
+ *       its kind byte then says that a count byte and count blocks of
+ *       start and end (exclusive) sequence numbers follow, one byte each in
+ *       v1 and two in v2:
+ *
+ *         ack  |<- v1 or v2 ack ->| n 1 | start | end | ... |
+ *
+ *       With rdt_config.coalesce the payload of a data packet is a run of
+ *       records, each a byte of flags and length followed by that many
+ *       bytes of one message, so several small messages (or the tail of
+ *       one and the head of the next) share a packet:
+ *
+ *         payload |end<<7 | len 7 bits|<- len bytes ->| ... |
+ *
+ *       The end bit says the record finishes its message; the header's
+ *       last bit then repeats the end bit of the final record.
+ *
+ *       With rdt_config.fec, parity packets (rdt_fec.h) are told apart from
+ *       data packets by a payload size of 0, which no data packet has:
+ *
+ *         v1     |<- checksum ->| 0 | first 1 | index 1 |<- symbol ->|
+ *         v2     |<- checksum ->| 0x80 | 2<<4 | first 2 | index 1 |
+ *                |<- symbol ->|
+ *         v3     |<- checksum ->| 0x80 | 3<<4 | conn 2 | first 2 | index 1 |
+ *                |<- symbol ->|
+ *
+ *       first is the sequence number of the block's first data packet and
+ *       index the parity symbol's number.  The symbol of a data packet is
+ *       its size | last<<7 byte followed by its payload, zero padded to
+ *       the symbol size; a data payload is then one byte shorter than the
+ *       symbol, so that a parity packet fits in RDT_PKTSIZE.
+ *
+ *       The checksum is crc16 (2 bytes) by default, or crc32c (4 bytes, see
+ *       rdt_checksum.h), which moves everything after it two bytes along
+ *       and shortens the payload by two.  v1 and v2 packets belong to
+ *       connection 0.  The top bit of the byte after
+ *       the checksum is never set by v1
+ *       (sizes are at most 124, kinds at most 2), so it marks an extended
+ *       header whose version sits in the high nibble of the next byte.
+ *       The checksum covers everything after itself, header included, and
+ *       a packet of the wrong version is rejected like a corrupted one.
+ *       Multi-byte fields are little endian.  Both ends take the version
+ *       and the checksum from rdt_config, which is how they agree on them.
+ */
+
+
+#ifndef _RDT_HEADER_H_
+#define _RDT_HEADER_H_
+
+#include "rdt_struct.h"
+#include "rdt_checksum.h"
+#include "utils.h"
+
+
+/* header versions */
+enum {HDR_V1=1, HDR_V2, HDR_V3, HDR_NUM};
+
+/* the properties of a header version */
+struct hdr_format {
+    int version;
+    int checksum;           /* CSUM_CRC16 or CSUM_CRC32C */
+    int csum_size;          /* checksum bytes at the start of a packet */
+    seq_nr_t seq_space;     /* sequence numbers wrap here, a power of two */
+    int max_window;         /* largest usable window, half the space */
+    int data_header;        /* header bytes of a data packet, checksum included */
+    int max_payload;
+    int ack_size;           /* bytes covered by the checksum of an ack
+                               without SACK blocks */
+    int parity_header;      /* header bytes of a parity packet */
+};
+
+struct data_header {
+    int conn;               /* connection ID, 0 before v3 */
+    int size;               /* payload bytes */
+    seq_nr_t seq;
+    bool last;              /* last packet of a message */
+};
+
+/* the record header of a coalesced payload */
+#define RECORD_END 0x80     /* the record ends its message */
+#define RECORD_LEN 0x7f     /* bytes in the record */
+
+/* most SACK blocks in one ack */
+#define SACK_MAX_BLOCKS 16
+
+/* packets start up to (not including) end are held by the receiver */
+struct sack_block {
+    seq_nr_t start;
+    seq_nr_t end;
+};
+
+struct ack_header {
+    int conn;               /* connection ID, 0 before v3 */
+    int kind;               /* ACK_CUMULATIVE, ACK_SELECTIVE or ACK_NAK */
+    seq_nr_t seq;
+    seq_nr_t cumack;        /* the last packet received in order */
+    int nsack;              /* SACK blocks, 0 for a plain ack */
+    struct sack_block sack[SACK_MAX_BLOCKS];
+};
+
+/* the format of a header version with the given checksum, NULL if there
+   is no such version or checksum */
+const struct hdr_format *Header_Format(int version, int checksum);
+
+/* write the header and checksum of a data packet whose payload is
+   already in place at data_header */
+void Header_PutData(const struct hdr_format *f, struct packet *pkt,
+                    const struct data_header *h);
+
+/* parse a data packet, false if it is corrupted or of another version */
+bool Header_GetData(const struct hdr_format *f, const struct packet *pkt,
+                    struct data_header *h);
+
+void Header_PutAck(const struct hdr_format *f, struct packet *pkt,
+                   const struct ack_header *h);
+
+/* parse an ack and its SACK blocks, false if it is corrupted or of
+   another version */
+bool Header_GetAck(const struct hdr_format *f, const struct packet *pkt,
+                   struct ack_header *h);
+
+struct parity_header {
+    int conn;               /* connection ID, 0 before v3 */
+    seq_nr_t first;         /* first data packet of the block */
+    int index;              /* parity symbol of the block */
+};
+
+/* bytes of an FEC symbol, the payload of a parity packet */
+static inline int Header_SymbolSize(const struct hdr_format *f)
+{
+    return RDT_PKTSIZE - f->parity_header;
+}
+
+/* write the header and checksum of a parity packet whose symbol is
+   already in place at parity_header */
+void Header_PutParity(const struct hdr_format *f, struct packet *pkt,
+                      const struct parity_header *h);
+
+/* parse a parity packet, false if it is corrupted, of another version or
+   not a parity packet */
+bool Header_GetParity(const struct hdr_format *f, const struct packet *pkt,
+                      struct parity_header *h);
+
+/* header version by name ("v1", "v2", "v3"), -1 if there is none */
+int Header_Parse(const char *name);
+
+/* name of a header version */
+const char *Header_Name(int version);
+
+#endif  /* _RDT_HEADER_H_ */
@@ -0,0 +1,154 @@
+/*
+ * FILE: rdt_impair.cc
+ * DESCRIPTION: Loss and delay models of the simulated link.
+ *
+ *       The bernoulli model draws exactly what the simulator drew before
+ *       the models were pluggable, from the same streams in the same
+ *       order, so its runs are unchanged.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdt_impair.h"
+
+
+static const char *loss_names[LOSS_NUM] = {"bernoulli", "ge", "trace"};
+
+
+void Impair_Init(struct impair *m, const struct impair_params *p,
+		 const std::vector<uint16_t> *trace, struct rdt_rng *loss_rng,
+		 struct rdt_rng *state_rng, struct rdt_rng *reorder_rng,
+		 struct rdt_rng *delay_rng, std::vector<uint16_t> *log)
+{
+    m->p = *p;
+    m->bad = false;
+    m->reordered = false;
+    m->trace = trace;
+    m->cursor = 0;
+    m->record = 0;
+    m->loss_rng = loss_rng;
+    m->state_rng = state_rng;
+    m->reorder_rng = reorder_rng;
+    m->delay_rng = delay_rng;
+    m->log = log;
+    m->last_lost = false;
+    memset(&m->stats, 0, sizeof(m->stats));
+}
+
+bool Impair_Lost(struct impair *m)
+{
+    bool lost;
+    switch (m->p.model) {
+    case LOSS_GE:
+	/* lost in the current state, then move on */
+	lost = rng_uniform(m->loss_rng) <
+	    (m->bad ? m->p.ge_bad_loss : m->p.ge_good_loss);
+	if (rng_uniform(m->state_rng) < (m->bad ? m->p.ge_r : m->p.ge_p))
+	    m->bad = !m->bad;
+	break;
+    case LOSS_TRACE:
+	m->record = (*m->trace)[m->cursor];
+	if (++m->cursor==m->trace->size()) m->cursor = 0;
+	lost = m->record==IMPAIR_LOST;
+	break;
+    default:
+	lost = rng_uniform(m->loss_rng)<m->p.loss_rate;
+	break;
+    }
+
+    m->stats.packets++;
+    if (lost) {
+	m->stats.lost++;
+	if (!m->last_lost) m->stats.bursts++;
+	if (m->log!=NULL) m->log->push_back(IMPAIR_LOST);
+    }
+    m->last_lost = lost;
+    return lost;
+}
+
+double Impair_Delay(struct impair *m)
+{
+    double delay;
+    if (m->p.model==LOSS_TRACE)
+	delay = m->record * IMPAIR_UNIT;
+    else {
+	/* reordered packets take a random delay up to twice the latency */
+	double c = m->p.reorder_corr;
+	double rate = (1 - c) * m->p.outoforder_rate + (m->reordered ? c : 0);
+	m->reordered = rng_uniform(m->reorder_rng)<rate;
+	if (m->reordered)
+	    delay = m->p.latency*2.0*rng_uniform(m->delay_rng);
+	else
+	    delay = m->p.latency;
+    }
+
+    if (m->log!=NULL) {
+	double units = delay / IMPAIR_UNIT + 0.5;
+	m->log->push_back(units<IMPAIR_LOST ? (uint16_t) units : IMPAIR_LOST - 1);
+    }
+    return delay;
+}
+
+int Impair_Load(const char *path, std::vector<uint16_t> trace[2])
+{
+    FILE *f = fopen(path, "rb");
+    if (f==NULL) return -1;
+
+    struct impair_file_header h;
+    int ok = fread(&h, sizeof(h), 1, f)==1 && h.magic==IMPAIR_MAGIC &&
+	h.version==IMPAIR_VERSION && h.record_size==sizeof(uint16_t) &&
+	h.count[0]>0 && h.count[1]>0;
+    for (int d=0; ok && d<2; d++) {
+	trace[d].resize(h.count[d]);
+	ok = fread(trace[d].data(), sizeof(uint16_t), h.count[d], f)==h.count[d];
+    }
+
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+int Impair_Save(const char *path, const std::vector<uint16_t> trace[2])
+{
+    FILE *f = fopen(path, "wb");
+    if (f==NULL) return -1;
+
+    struct impair_file_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = IMPAIR_MAGIC;
+    h.version = IMPAIR_VERSION;
+    h.record_size = sizeof(uint16_t);
+    h.count[0] = trace[0].size();
+    h.count[1] = trace[1].size();
+
+    int ok = fwrite(&h, sizeof(h), 1, f)==1;
+    for (int d=0; ok && d<2; d++)
+	ok = fwrite(trace[d].data(), sizeof(uint16_t), h.count[d], f)==h.count[d];
+
+    if (fclose(f)!=0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+double Impair_MinDelay(const std::vector<uint16_t> trace[2])
+{
+    int least = IMPAIR_LOST;
+    for (int d=0; d<2; d++)
+	for (size_t i=0; i<trace[d].size(); i++)
+	    if (trace[d][i]<least) least = trace[d][i];
+    return least==IMPAIR_LOST ? -1 : least * IMPAIR_UNIT;
+}
+
+int Loss_Parse(const char *name)
+{
+    for (int i=0; i<LOSS_NUM; i++)
+	if (strcmp(name, loss_names[i])==0) return i;
+    return -1;
+}
+
+const char *Loss_Name(int model)
+{
+    if (model<0 || model>=LOSS_NUM) return "unknown";
+    return loss_names[model];
+}
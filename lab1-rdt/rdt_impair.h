@@ -0,0 +1,125 @@
+/*
+ * FILE: rdt_impair.h
+ * DESCRIPTION: Loss and delay models of the simulated link.
+ *
+ *       Every packet handed to the link asks its direction's model first
+ *       whether it is lost, then, if not, how long it takes to arrive.
+ *       Loss models are pluggable:
+ *
+ *         bernoulli  the original model: every packet is lost with the
+ *                    loss rate, independently of the others
+ *         ge         Gilbert-Elliott: a good and a bad state, left with
+ *                    probability p and r per packet, losing packets with
+ *                    probability good_loss and bad_loss.  losses come in
+ *                    bursts of 1/r packets on average; the mean loss rate
+ *                    is (r * good_loss + p * bad_loss) / (p + r)
+ *         trace      replay of a recorded impairment trace, which gives
+ *                    the loss and the delay of every packet
+ *
+ *       Without a trace a packet takes the link latency, or with the
+ *       out-of-order rate a random delay up to twice that.  Reordering can
+ *       be correlated: with correlation c a packet is reordered with
+ *       probability c + (1 - c) * rate after a reordered packet and
+ *       (1 - c) * rate after one in order, which keeps the rate and makes
+ *       c the correlation of consecutive decisions.
+ *
+ *       A run can record what its models decided into a trace file, so
+ *       that other protocols can be run against the very same losses.
+ */
+
+
+#ifndef _RDT_IMPAIR_H_
+#define _RDT_IMPAIR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "rdt_random.h"
+
+
+/* loss models */
+enum {LOSS_BERNOULLI=0, LOSS_GE, LOSS_TRACE, LOSS_NUM};
+
+/* impairment trace file layout: an impair_file_header, then count[0]
+   records of the sender to receiver direction and count[1] of the other,
+   one per packet handed to the link.  a record is IMPAIR_LOST or the
+   packet's delay in units of IMPAIR_UNIT seconds.  replay starts over
+   at the first record of a direction when it runs out */
+#define IMPAIR_MAGIC    0x4c50494d54445252ULL   /* "RRDTMIPL" */
+#define IMPAIR_VERSION  1
+#define IMPAIR_LOST     0xffff
+#define IMPAIR_UNIT     1e-4
+
+struct impair_file_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;   /* sizeof(uint16_t) */
+    uint32_t count[2];
+};
+
+/* parameters of a direction's model */
+struct impair_params {
+    int model;
+    double loss_rate;       /* bernoulli */
+    double ge_p;            /* ge: good to bad, per packet */
+    double ge_r;            /* ge: bad to good, per packet */
+    double ge_good_loss;
+    double ge_bad_loss;
+    double outoforder_rate; /* bernoulli and ge */
+    double reorder_corr;
+    double latency;
+};
+
+/* statistics of one direction */
+struct impair_stats {
+    long long packets;      /* packets the model decided on */
+    long long lost;
+    long long bursts;       /* runs of consecutive losses */
+};
+
+/* the model of one direction */
+struct impair {
+    struct impair_params p;
+    bool bad;               /* ge: in the bad state */
+    bool reordered;         /* the last packet was reordered */
+    const std::vector<uint16_t> *trace;     /* trace: the records */
+    size_t cursor;          /* trace: the next record */
+    uint16_t record;        /* trace: that of the current packet */
+    struct rdt_rng *loss_rng;
+    struct rdt_rng *state_rng;      /* ge: state changes */
+    struct rdt_rng *reorder_rng;
+    struct rdt_rng *delay_rng;
+    std::vector<uint16_t> *log;     /* records what was decided, or NULL */
+    bool last_lost;
+    struct impair_stats stats;
+};
+
+/* set up a direction's model.  trace holds its records if the model is
+   trace, log collects the records of a recording run if not NULL */
+void Impair_Init(struct impair *m, const struct impair_params *p,
+                 const std::vector<uint16_t> *trace, struct rdt_rng *loss_rng,
+                 struct rdt_rng *state_rng, struct rdt_rng *reorder_rng,
+                 struct rdt_rng *delay_rng, std::vector<uint16_t> *log);
+
+/* true if the next packet is lost */
+bool Impair_Lost(struct impair *m);
+
+/* the time a packet that was not lost takes to arrive */
+double Impair_Delay(struct impair *m);
+
+/* read a trace file into the records of both directions, 0 on success */
+int Impair_Load(const char *path, std::vector<uint16_t> trace[2]);
+
+/* write the records of both directions to a trace file, 0 on success */
+int Impair_Save(const char *path, const std::vector<uint16_t> trace[2]);
+
+/* the least delay in a trace (in seconds), -1 if it loses every packet */
+double Impair_MinDelay(const std::vector<uint16_t> trace[2]);
+
+/* model by name ("bernoulli", "ge", "trace"), -1 if there is none */
+int Loss_Parse(const char *name);
+
+/* name of a model */
+const char *Loss_Name(int model);
+
+#endif  /* _RDT_IMPAIR_H_ */
@@ -0,0 +1,113 @@
+/*
+ * FILE: rdt_link.cc
+ * DESCRIPTION: Bottleneck link model of the simulator.
+ *
+ *       Red averages the queue it sees on every arrival.  An arrival at an
+ *       empty queue first decays the average as if the idle time had been
+ *       spent sending packets into an empty queue, one per transmission
+ *       time, as the paper suggests.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rdt_struct.h"
+#include "rdt_link.h"
+
+
+static const char *aqm_names[AQM_NUM] = {"droptail", "red"};
+
+
+void Link_Init(struct link *l, double bandwidth, int capacity, int aqm,
+	       struct rdt_rng *rng)
+{
+    memset(l, 0, sizeof(*l));
+    l->bandwidth = bandwidth;
+    l->capacity = capacity;
+    l->aqm = aqm;
+    l->rng = rng;
+    if (bandwidth>0) {
+	l->tx_time = RDT_PKTSIZE / bandwidth;
+	l->departures = (double*) malloc(capacity * sizeof(double));
+    }
+}
+
+void Link_Free(struct link *l)
+{
+    free(l->departures);
+    l->departures = NULL;
+}
+
+/* red: true if the arrival is dropped early, n is the current queue */
+static bool red_drop(struct link *l, double now, int n)
+{
+    if (n==0 && now>l->last_departure)
+	l->red_avg *= pow(1 - RED_WEIGHT, (now - l->last_departure) / l->tx_time);
+    l->red_avg += RED_WEIGHT * (n - l->red_avg);
+
+    double min_th = RED_MIN_TH * l->capacity, max_th = RED_MAX_TH * l->capacity;
+    if (l->red_avg<min_th) {
+	l->red_count = 0;
+	return false;
+    }
+    if (l->red_avg<max_th) {
+	/* spreading the drops out evenly: the probability grows with the
+	   packets accepted since the last one */
+	l->red_count++;
+	double pb = RED_MAX_P * (l->red_avg - min_th) / (max_th - min_th);
+	double pa = l->red_count*pb>=1 ? 1 : pb / (1 - l->red_count*pb);
+	if (rng_uniform(l->rng)>=pa) return false;
+    }
+    l->red_count = 0;
+    return true;
+}
+
+bool Link_Send(struct link *l, double now, double *departure)
+{
+    l->stats.offered++;
+    if (l->bandwidth<=0) {
+	*departure = now;
+	return true;
+    }
+
+    /* the packets that left before now */
+    while (l->count>0 && l->departures[l->head]<=now) {
+	l->head = (l->head + 1) % l->capacity;
+	l->count--;
+    }
+
+    if (l->aqm==AQM_RED && red_drop(l, now, l->count)) {
+	l->stats.early_drops++;
+	return false;
+    }
+    if (l->count==l->capacity) {
+	l->stats.tail_drops++;
+	return false;
+    }
+
+    double start = l->count>0 ? l->last_departure : now;
+    *departure = start + l->tx_time;
+    l->departures[(l->head + l->count) % l->capacity] = *departure;
+    l->count++;
+    l->last_departure = *departure;
+
+    if (l->count>l->stats.max_queue) l->stats.max_queue = l->count;
+    l->stats.sojourn += *departure - now;
+    l->stats.busy += l->tx_time;
+    return true;
+}
+
+int Aqm_Parse(const char *name)
+{
+    for (int i=0; i<AQM_NUM; i++)
+	if (strcmp(name, aqm_names[i])==0) return i;
+    return -1;
+}
+
+const char *Aqm_Name(int aqm)
+{
+    if (aqm<0 || aqm>=AQM_NUM) return "unknown";
+    return aqm_names[aqm];
+}
@@ -0,0 +1,84 @@
+/*
+ * FILE: rdt_link.h
+ * DESCRIPTION: Bottleneck link model of the simulator.
+ *
+ *       Each direction of the link is a FIFO queue in front of a
+ *       transmitter of a given bandwidth: a packet waits for the packets
+ *       ahead of it, takes RDT_PKTSIZE / bandwidth seconds to put on the
+ *       wire, then propagates for the link latency.  The queue holds at
+ *       most capacity packets, the one being transmitted included, and
+ *       drops arrivals by one of these disciplines:
+ *
+ *         droptail  only when it is full
+ *         red       random early detection (Floyd and Jacobson, 1993):
+ *                   with probability rising from 0 to RED_MAX_P as the
+ *                   average queue grows from RED_MIN_TH to RED_MAX_TH of
+ *                   the capacity, always above that or when it is full
+ *
+ *       A bandwidth of 0 is the original model, an infinitely fast link
+ *       without a queue.  Departures are fixed as packets arrive, so the
+ *       queue is a ring of departure times that needs no events of its own.
+ */
+
+
+#ifndef _RDT_LINK_H_
+#define _RDT_LINK_H_
+
+#include "rdt_random.h"
+
+
+/* queue disciplines */
+enum {AQM_DROPTAIL=0, AQM_RED, AQM_NUM};
+
+/* default queue capacity (in packets) */
+#define LINK_QUEUE 64
+
+/* RED: thresholds as fractions of the capacity, the drop probability at
+   the upper one, and the weight of a sample in the average queue */
+#define RED_MIN_TH  0.25
+#define RED_MAX_TH  0.75
+#define RED_MAX_P   0.1
+#define RED_WEIGHT  0.002
+
+/* statistics of one direction */
+struct link_stats {
+    long long offered;      /* packets handed to the link */
+    long long tail_drops;   /* dropped by a full queue */
+    long long early_drops;  /* dropped by red before the queue filled */
+    int max_queue;          /* most packets queued at once */
+    double sojourn;         /* total time packets spent queued and transmitted */
+    double busy;            /* total time the transmitter was busy */
+};
+
+struct link {
+    double bandwidth;       /* bytes per second, 0 for no limit */
+    int capacity;
+    int aqm;
+    double tx_time;         /* transmission time of a packet */
+    double *departures;     /* ring of the queued packets' departure times */
+    int head;
+    int count;
+    double last_departure;  /* of the packet queued last */
+    double red_avg;         /* red: average queue */
+    int red_count;          /* red: packets accepted since the last drop */
+    struct rdt_rng *rng;    /* red: drop decisions */
+    struct link_stats stats;
+};
+
+/* set up a link direction, rng is only used by red */
+void Link_Init(struct link *l, double bandwidth, int capacity, int aqm,
+               struct rdt_rng *rng);
+
+void Link_Free(struct link *l);
+
+/* a packet enters the link at time now.  false if the queue drops it,
+   otherwise *departure is the time its last bit leaves the transmitter */
+bool Link_Send(struct link *l, double now, double *departure);
+
+/* discipline by name ("droptail", "red"), -1 if there is none */
+int Aqm_Parse(const char *name);
+
+/* name of a discipline */
+const char *Aqm_Name(int aqm);
+
+#endif  /* _RDT_LINK_H_ */
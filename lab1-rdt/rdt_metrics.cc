@@ -0,0 +1,422 @@
+/*
+ * FILE: rdt_metrics.cc
+ * DESCRIPTION: End-to-end metrics of a simulation run.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+
+#include "rdt_sender.h"
+#include "rdt_metrics.h"
+#include "rdt_pdes.h"
+
+
+/*[]------------------------------------------------------------------------[]
+  |  latency histogram
+  []------------------------------------------------------------------------[]*/
+
+/* values below HIST_SUB_COUNT get a bucket each, above that every power of
+   two is split into HIST_HALF_COUNT buckets */
+static int hist_index(uint64_t v)
+{
+    if (v<HIST_SUB_COUNT) return (int) v;
+
+    int magnitude = 63 - __builtin_clzll(v);
+    int shift = magnitude - HIST_SUB_BITS + 1;
+    return shift*HIST_HALF_COUNT + (int)(v >> shift);
+}
+
+/* highest value that falls into the bucket */
+static uint64_t hist_upper(int index)
+{
+    if (index<HIST_SUB_COUNT) return (uint64_t) index;
+
+    int shift = index/HIST_HALF_COUNT - 1;
+    uint64_t sub = (uint64_t)(index - shift*HIST_HALF_COUNT);
+    return ((sub+1) << shift) - 1;
+}
+
+void Hist_Init(struct hdr_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void Hist_Record(struct hdr_hist *h, uint64_t value)
+{
+    h->counts[hist_index(value)]++;
+    h->total++;
+    h->sum += (double) value;
+    if (value<h->min) h->min = value;
+    if (value>h->max) h->max = value;
+}
+
+uint64_t Hist_Percentile(const struct hdr_hist *h, double fraction)
+{
+    if (h->total==0) return 0;
+
+    uint64_t rank = (uint64_t)(fraction * h->total + 0.5);
+    if (rank<1) rank = 1;
+    if (rank>h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    for (int i=0; i<HIST_BUCKETS; i++) {
+	seen += h->counts[i];
+	if (seen>=rank) {
+	    uint64_t v = hist_upper(i);
+	    return v>h->max ? h->max : v;
+	}
+    }
+    return h->max;
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  collected metrics
+  []------------------------------------------------------------------------[]*/
+
+/* a queue depth averaged over simulation time */
+struct time_avg {
+    int value;
+    int max;
+    double since;           /* time of the last change */
+    double area;            /* integral of value over time */
+};
+
+static void time_avg_set(struct time_avg *a, int value, double now)
+{
+    a->area += (double) a->value * (now - a->since);
+    a->since = now;
+    a->value = value;
+    if (value>a->max) a->max = value;
+}
+
+static double time_avg_mean(struct time_avg *a, double end)
+{
+    time_avg_set(a, a->value, end);
+    return end>0 ? a->area / end : 0;
+}
+
+/* a generated message waiting to be delivered */
+struct msg_stamp {
+    int conn;
+    long long end;          /* stream offset just past the message */
+    double sent;            /* generation time */
+};
+
+/* latencies, round-trip and recovery times are recorded in microseconds */
+static struct hdr_hist latency;
+static bool latency_init = false;
+static struct hdr_hist rtt;
+static struct hdr_hist recovery;
+static bool retx_init = false;
+static double last_rto = 0;
+
+static long long pkts_sent = 0;
+static long long pkts_retransmitted = 0;
+static long long dups_discarded = 0;
+static long long acks_sent = 0;
+static long long parity_sent = 0;
+static long long fec_recovered = 0;
+static long long timeouts = 0;
+static long long fast_retransmits = 0;
+static struct time_avg window_depth = {0, 0, 0, 0};
+static struct time_avg waiting_depth = {0, 0, 0, 0};
+static struct time_avg cwnd_size = {0, 0, 0, 0};
+static int sendbuf_capacity = 0;
+static int sendbuf_high_water = 0;
+static long long sendbuf_high_water_bytes = 0;
+static long long upper_blocked = 0;
+static double upper_blocked_time = 0;
+
+/* the messages of a connection are delivered in order, so a FIFO of
+   stream offsets per connection matches every delivery with its
+   generation time.  the sender side pushes the stamps into in_flight and
+   keeps the offsets of stream_sent, the receiver side moves them on to the
+   FIFO of their connection and keeps those of stream_delivered; the two
+   run on threads of their own with --pdes.  a message is generated
+   before any of its packets is sent, so its stamp is in in_flight by the
+   time it is delivered */
+static SpscQueue<struct msg_stamp> in_flight;
+static std::vector<long long> stream_sent;
+static std::vector<long long> stream_delivered;
+static std::vector<std::deque<struct msg_stamp> > conn_in_flight;
+
+
+/*[]------------------------------------------------------------------------[]
+  |  hooks
+  []------------------------------------------------------------------------[]*/
+
+void Metrics_PacketSent(bool retransmission)
+{
+    pkts_sent++;
+    if (retransmission) pkts_retransmitted++;
+}
+
+void Metrics_SenderQueues(int window, int waiting)
+{
+    double now = GetSimulationTime();
+    time_avg_set(&window_depth, window, now);
+    time_avg_set(&waiting_depth, waiting, now);
+    if (window + waiting>sendbuf_high_water) sendbuf_high_water = window + waiting;
+}
+
+void Metrics_SendBuffer(int capacity)
+{
+    sendbuf_capacity = capacity;
+}
+
+void Metrics_SenderMemory(long long bytes)
+{
+    if (bytes>sendbuf_high_water_bytes) sendbuf_high_water_bytes = bytes;
+}
+
+void Metrics_UpperLayerBlocked(double time)
+{
+    upper_blocked++;
+    upper_blocked_time += time;
+}
+
+static void retx_hists_init()
+{
+    if (!retx_init) {
+	Hist_Init(&rtt);
+	Hist_Init(&recovery);
+	retx_init = true;
+    }
+}
+
+void Metrics_RttSample(double sample, double rto)
+{
+    retx_hists_init();
+    Hist_Record(&rtt, (uint64_t)(sample * 1e6 + 0.5));
+    last_rto = rto;
+}
+
+void Metrics_CongestionWindow(int cwnd)
+{
+    if (cwnd!=cwnd_size.value)
+	time_avg_set(&cwnd_size, cwnd, GetSimulationTime());
+}
+
+void Metrics_Timeout()
+{
+    timeouts++;
+}
+
+void Metrics_FastRetransmit()
+{
+    fast_retransmits++;
+}
+
+void Metrics_Recovered(double time)
+{
+    retx_hists_init();
+    Hist_Record(&recovery, (uint64_t)(time * 1e6 + 0.5));
+}
+
+void Metrics_DuplicateDiscarded()
+{
+    dups_discarded++;
+}
+
+void Metrics_AckSent()
+{
+    acks_sent++;
+}
+
+void Metrics_ParitySent()
+{
+    parity_sent++;
+}
+
+void Metrics_FecRecovered()
+{
+    fec_recovered++;
+}
+
+void Metrics_Connections(int n)
+{
+    stream_sent.assign(n, 0);
+    stream_delivered.assign(n, 0);
+    conn_in_flight.resize(n);
+}
+
+void Metrics_MessageSent(int conn, int size)
+{
+    stream_sent[conn] += size;
+    struct msg_stamp stamp = {conn, stream_sent[conn], GetSimulationTime()};
+    in_flight.push(stamp);
+}
+
+void Metrics_MessageDelivered(int conn, int size)
+{
+    if (!latency_init) {
+	Hist_Init(&latency);
+	latency_init = true;
+    }
+
+    struct msg_stamp *stamp;
+    while ((stamp = in_flight.front())!=NULL) {
+	conn_in_flight[stamp->conn].push_back(*stamp);
+	in_flight.pop();
+    }
+
+    double now = GetSimulationTime();
+    std::deque<struct msg_stamp> &q = conn_in_flight[conn];
+    stream_delivered[conn] += size;
+    while (!q.empty() && q.front().end<=stream_delivered[conn]) {
+	double delay = now - q.front().sent;
+	Hist_Record(&latency, (uint64_t)(delay * 1e6 + 0.5));
+	q.pop_front();
+    }
+}
+
+
+/*[]------------------------------------------------------------------------[]
+  |  report
+  []------------------------------------------------------------------------[]*/
+
+void Metrics_Retransmissions(struct metrics_retx *m)
+{
+    retx_hists_init();
+    m->retransmissions = pkts_retransmitted;
+    m->spurious = dups_discarded;
+    m->timeouts = timeouts;
+    m->fast_retransmits = fast_retransmits;
+    m->recovery_mean = recovery.total>0 ? recovery.sum / recovery.total * 1e-6 : 0;
+}
+
+void Metrics_SendBufferUsage(struct metrics_sendbuf *m)
+{
+    m->capacity = sendbuf_capacity;
+    m->high_water = sendbuf_high_water;
+    m->high_water_bytes = sendbuf_high_water_bytes;
+    m->blocked = upper_blocked;
+    m->blocked_time = upper_blocked_time;
+}
+
+/* summary of a histogram of microseconds as a JSON object body */
+static void write_hist(FILE *f, const char *indent, const struct hdr_hist *h)
+{
+    fprintf(f, "%s\"count\": %llu,\n"
+	    "%s\"mean\": %.6f,\n"
+	    "%s\"min\": %.6f,\n"
+	    "%s\"p50\": %.6f,\n"
+	    "%s\"p90\": %.6f,\n"
+	    "%s\"p99\": %.6f,\n"
+	    "%s\"p999\": %.6f,\n"
+	    "%s\"max\": %.6f\n",
+	    indent, (unsigned long long) h->total,
+	    indent, h->total>0 ? h->sum / h->total * 1e-6 : 0.0,
+	    indent, h->total>0 ? h->min * 1e-6 : 0.0,
+	    indent, Hist_Percentile(h, 0.50) * 1e-6,
+	    indent, Hist_Percentile(h, 0.90) * 1e-6,
+	    indent, Hist_Percentile(h, 0.99) * 1e-6,
+	    indent, Hist_Percentile(h, 0.999) * 1e-6,
+	    indent, h->max * 1e-6);
+}
+
+static void write_link(FILE *f, const char *dir, const struct link_stats *s,
+		       double end, bool last)
+{
+    long long accepted = s->offered - s->tail_drops - s->early_drops;
+    fprintf(f, "    \"%s\": {\n"
+	    "      \"offered\": %lld,\n"
+	    "      \"tail_drops\": %lld,\n"
+	    "      \"early_drops\": %lld,\n"
+	    "      \"queue_mean\": %.3f,\n"
+	    "      \"queue_max\": %d,\n"
+	    "      \"sojourn_mean_sec\": %.6f,\n"
+	    "      \"utilization\": %.6f\n"
+	    "    }%s\n",
+	    dir, s->offered, s->tail_drops, s->early_drops,
+	    end>0 ? s->sojourn / end : 0.0, s->max_queue,
+	    accepted>0 ? s->sojourn / accepted : 0.0, end>0 ? s->busy / end : 0.0,
+	    last ? "" : ",");
+}
+
+void Metrics_WriteJSON(FILE *f, const char *params_json,
+		       const struct metrics_totals *t)
+{
+    if (!latency_init) {
+	Hist_Init(&latency);
+	latency_init = true;
+    }
+    retx_hists_init();
+
+    double goodput = t->end_time>0 ? t->chars_delivered / t->end_time : 0;
+    long long first_sends = pkts_sent - pkts_retransmitted;
+
+    fprintf(f, "{\n  \"params\": %s,\n", params_json);
+    fprintf(f, "  \"end_time\": %.6f,\n"
+	    "  \"chars_sent\": %lld,\n"
+	    "  \"chars_delivered\": %lld,\n"
+	    "  \"pkts_passed\": %lld,\n"
+	    "  \"goodput_bytes_per_sec\": %.3f,\n"
+	    "  \"verified\": %s,\n",
+	    t->end_time, t->chars_sent, t->chars_delivered, t->pkts_passed,
+	    goodput, t->verified ? "true" : "false");
+    fprintf(f, "  \"sender\": {\n"
+	    "    \"data_pkts_sent\": %lld,\n"
+	    "    \"retransmissions\": %lld,\n"
+	    "    \"retransmission_ratio\": %.6f,\n"
+	    "    \"window_mean\": %.3f,\n"
+	    "    \"window_max\": %d,\n"
+	    "    \"waiting_buffer_mean\": %.3f,\n"
+	    "    \"waiting_buffer_max\": %d,\n"
+	    "    \"cwnd_mean\": %.3f,\n"
+	    "    \"cwnd_max\": %d,\n"
+	    "    \"send_buffer_capacity\": %d,\n"
+	    "    \"send_buffer_high_water\": %d,\n"
+	    "    \"send_buffer_high_water_bytes\": %lld,\n"
+	    "    \"upper_layer_blocked\": %lld,\n"
+	    "    \"upper_layer_blocked_sec\": %.6f,\n"
+	    "    \"parity_sent\": %lld\n"
+	    "  },\n",
+	    pkts_sent, pkts_retransmitted,
+	    first_sends>0 ? (double) pkts_retransmitted / first_sends : 0.0,
+	    time_avg_mean(&window_depth, t->end_time), window_depth.max,
+	    time_avg_mean(&waiting_depth, t->end_time), waiting_depth.max,
+	    time_avg_mean(&cwnd_size, t->end_time), cwnd_size.max,
+	    sendbuf_capacity, sendbuf_high_water, sendbuf_high_water_bytes,
+	    upper_blocked, upper_blocked_time, parity_sent);
+    fprintf(f, "  \"receiver\": {\n"
+	    "    \"duplicates_discarded\": %lld,\n"
+	    "    \"acks_sent\": %lld,\n"
+	    "    \"fec_recovered\": %lld\n"
+	    "  },\n", dups_discarded, acks_sent, fec_recovered);
+    fprintf(f, "  \"retransmission\": {\n"
+	    "    \"timeouts\": %lld,\n"
+	    "    \"fast_retransmits\": %lld,\n"
+	    "    \"spurious\": %lld,\n"
+	    "    \"spurious_ratio\": %.6f,\n"
+	    "    \"final_rto\": %.6f,\n"
+	    "    \"rtt_sec\": {\n",
+	    timeouts, fast_retransmits, dups_discarded,
+	    pkts_retransmitted>0 ? (double) dups_discarded / pkts_retransmitted : 0.0,
+	    last_rto);
+    write_hist(f, "      ", &rtt);
+    fprintf(f, "    },\n    \"recovery_sec\": {\n");
+    write_hist(f, "      ", &recovery);
+    fprintf(f, "    }\n  },\n");
+    fprintf(f, "  \"latency_sec\": {\n");
+    write_hist(f, "    ", &latency);
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"link\": {\n");
+    write_link(f, "sender_to_receiver", t->s2r, t->end_time, false);
+    write_link(f, "receiver_to_sender", t->r2s, t->end_time, true);
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"simulator\": {\n"
+	    "    \"events\": %llu,\n"
+	    "    \"events_per_sec\": %.0f,\n"
+	    "    \"connections\": %d,\n"
+	    "    \"memory_per_connection_bytes\": %.0f\n"
+	    "  }\n}\n",
+	    t->events, t->wall_time>0 ? t->events / t->wall_time : 0.0,
+	    t->connections, t->memory_per_conn);
+}
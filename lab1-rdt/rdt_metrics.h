@@ -0,0 +1,161 @@
+/*
+ * FILE: rdt_metrics.h
+ * DESCRIPTION: End-to-end metrics of a simulation run.
+ *
+ *       The simulator reports message generation and delivery, the rdt
+ *       layers report their own events through the hooks below.  Message
+ *       latency (generate_msg() to Receiver_ToUpperLayer()) goes into an
+ *       HDR-style log-linear histogram; queue depths are averaged over
+ *       simulation time.  With several connections (rdt_conn.h) the
+ *       sender reports its queues, windows and memory summed over all of
+ *       them.  Metrics_WriteJSON() dumps everything at the end.
+ */
+
+
+#ifndef _RDT_METRICS_H_
+#define _RDT_METRICS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "rdt_link.h"
+
+
+/*[]------------------------------------------------------------------------[]
+  |  latency histogram
+  []------------------------------------------------------------------------[]*/
+
+/* 2^HIST_SUB_BITS sub-buckets per power of two, i.e. values are recorded
+   with a relative error below 2^-(HIST_SUB_BITS-1) (1.6%) */
+#define HIST_SUB_BITS   7
+#define HIST_SUB_COUNT  (1 << HIST_SUB_BITS)
+#define HIST_HALF_COUNT (HIST_SUB_COUNT / 2)
+#define HIST_BUCKETS    ((64 - HIST_SUB_BITS + 2) * HIST_HALF_COUNT)
+
+struct hdr_hist {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+};
+
+void Hist_Init(struct hdr_hist *h);
+void Hist_Record(struct hdr_hist *h, uint64_t value);
+/* the value below which the given fraction (0..1) of the samples fall,
+   reported as the highest value equivalent to its bucket */
+uint64_t Hist_Percentile(const struct hdr_hist *h, double fraction);
+
+
+/*[]------------------------------------------------------------------------[]
+  |  hooks
+  []------------------------------------------------------------------------[]*/
+
+/* the sender passes a data packet to the lower layer, retransmission is
+   true if the packet has been sent before */
+void Metrics_PacketSent(bool retransmission);
+
+/* the sender window or waiting buffer changed size */
+void Metrics_SenderQueues(int window, int waiting);
+
+/* the capacity (in packets) of the sender's send buffer, which holds both
+   the window and the waiting buffer */
+void Metrics_SendBuffer(int capacity);
+
+/* the sender's send buffer now takes bytes of memory: its window of built
+   packets plus the messages still waiting to be packetized */
+void Metrics_SenderMemory(long long bytes);
+
+/* the upper layer at the sender was held back by a full send buffer for
+   the given time */
+void Metrics_UpperLayerBlocked(double time);
+
+/* the sender took a round-trip time sample, rto is the resulting
+   retransmission timeout */
+void Metrics_RttSample(double rtt, double rto);
+
+/* the sender's congestion window (in packets) may have changed */
+void Metrics_CongestionWindow(int cwnd);
+
+/* the sender's retransmission timer expired */
+void Metrics_Timeout();
+
+/* the sender resent a packet after duplicate acks */
+void Metrics_FastRetransmit();
+
+/* a packet that needed retransmission was acknowledged, time is the time
+   since its first transmission */
+void Metrics_Recovered(double time);
+
+/* the receiver dropped a data packet it had already received.  the links
+   never duplicate packets, so every such packet is a spurious
+   retransmission */
+void Metrics_DuplicateDiscarded();
+
+/* the receiver sent an ack */
+void Metrics_AckSent();
+
+/* the sender sent an FEC parity packet */
+void Metrics_ParitySent();
+
+/* the receiver rebuilt a lost data packet from FEC parity */
+void Metrics_FecRecovered();
+
+/* the simulation runs n connections (rdt_conn.h), called before any
+   message is generated */
+void Metrics_Connections(int n);
+
+/* the upper layer at the sender generated a message on a connection */
+void Metrics_MessageSent(int conn, int size);
+
+/* the receiver delivered a message of a connection to the upper layer */
+void Metrics_MessageDelivered(int conn, int size);
+
+
+/*[]------------------------------------------------------------------------[]
+  |  report
+  []------------------------------------------------------------------------[]*/
+
+/* totals kept by the simulator, passed in for the report */
+struct metrics_totals {
+    double end_time;
+    long long chars_sent;
+    long long chars_delivered;
+    long long pkts_passed;
+    unsigned long long events;
+    double wall_time;
+    bool verified;
+    int connections;
+    double memory_per_conn;     /* connection state allocated per connection (in bytes) */
+    const struct link_stats *s2r;       /* link queues, see rdt_link.h */
+    const struct link_stats *r2s;
+};
+
+/* retransmission summary, also reported by the sweep runner */
+struct metrics_retx {
+    long long retransmissions;
+    long long spurious;
+    long long timeouts;
+    long long fast_retransmits;
+    double recovery_mean;   /* mean recovery time (in seconds) */
+};
+
+void Metrics_Retransmissions(struct metrics_retx *m);
+
+/* send buffer summary */
+struct metrics_sendbuf {
+    int capacity;           /* packets */
+    int high_water;         /* most packets held at once */
+    long long high_water_bytes;     /* most memory held at once */
+    long long blocked;      /* times the upper layer was held back */
+    double blocked_time;    /* total time it was held back (in seconds) */
+};
+
+void Metrics_SendBufferUsage(struct metrics_sendbuf *m);
+
+/* write all metrics as one JSON object, params_json is the already
+   formatted "params" object */
+void Metrics_WriteJSON(FILE *f, const char *params_json,
+                       const struct metrics_totals *t);
+
+#endif  /* _RDT_METRICS_H_ */
@@ -0,0 +1,108 @@
+/*
+ * FILE: rdt_pdes.h
+ * DESCRIPTION: Conservative parallel simulation of the rdt simulator.
+ *
+ *       With --pdes the simulation is split into two logical processes,
+ *       each with its own event chain and thread: the sender side (message
+ *       arrivals, sender timers, acks arriving) and the receiver side (data
+ *       packets arriving, receiver timers).  They only talk by packets,
+ *       which cross the link in a channel, an SpscQueue of timestamped
+ *       arrivals.
+ *
+ *       A packet takes at least the lookahead to cross the link: its
+ *       serialization time plus the propagation delay, or only the former
+ *       when reordering can shorten the delay.  So a process whose next
+ *       event is at t, or that may still receive a packet at t, sends
+ *       nothing arriving before t + lookahead, and publishes that as its
+ *       promise (Chandy-Misra null messages, as a shared variable).  Each
+ *       process only runs events before its peer's promise.
+ *
+ *       Events are ordered by time, then by the process that scheduled
+ *       them, then by the order it scheduled them in; the sequential run
+ *       uses the same order, so both give identical results.  A counter of
+ *       busy processes plus packets in the channels reaches zero exactly
+ *       when the simulation is over.
+ */
+
+
+#ifndef _RDT_PDES_H_
+#define _RDT_PDES_H_
+
+#include <stddef.h>
+#include <atomic>
+
+
+/* items per chunk of an SpscQueue */
+#define SPSC_CHUNK 256
+
+/* unbounded lock-free queue of one producer thread and one consumer
+   thread.  items go into a linked list of chunks; the producer publishes
+   each one by bumping a counter, which also orders its write of the link
+   to the next chunk before the consumer follows it */
+template <class T>
+class SpscQueue
+{
+    struct Chunk {
+	T items[SPSC_CHUNK];
+	Chunk *next;
+    };
+
+    /* producer side */
+    alignas(64) Chunk *tail_chunk;
+    size_t tail;
+    unsigned long long npushed;
+    alignas(64) std::atomic<unsigned long long> published;
+    /* consumer side */
+    alignas(64) Chunk *head_chunk;
+    size_t head;
+    unsigned long long npopped;
+
+public:
+    SpscQueue() : published(0) {
+	head_chunk = tail_chunk = new Chunk;
+	head_chunk->next = NULL;
+	head = tail = 0;
+	npushed = npopped = 0;
+    }
+
+    ~SpscQueue() {
+	while (head_chunk!=NULL) {
+	    Chunk *next = head_chunk->next;
+	    delete head_chunk;
+	    head_chunk = next;
+	}
+    }
+
+    /* producer: append an item */
+    void push(const T &item) {
+	if (tail==SPSC_CHUNK) {
+	    Chunk *c = new Chunk;
+	    c->next = NULL;
+	    tail_chunk->next = c;
+	    tail_chunk = c;
+	    tail = 0;
+	}
+	tail_chunk->items[tail++] = item;
+	published.store(++npushed, std::memory_order_release);
+    }
+
+    /* consumer: the first item, NULL if there is none yet */
+    T *front() {
+	if (npopped==published.load(std::memory_order_acquire)) return NULL;
+	if (head==SPSC_CHUNK) {
+	    Chunk *c = head_chunk;
+	    head_chunk = c->next;
+	    head = 0;
+	    delete c;
+	}
+	return &head_chunk->items[head];
+    }
+
+    /* consumer: remove the item front() returned */
+    void pop() {
+	head++;
+	npopped++;
+    }
+};
+
+#endif  /* _RDT_PDES_H_ */
@@ -0,0 +1,91 @@
+/*
+ * FILE: rdt_random.h
+ * DESCRIPTION: Deterministic pseudo random number streams for the simulator.
+ *
+ *       xoshiro256** (Blackman and Vigna, 2018), seeded with splitmix64.
+ *       Stream i of a seed starts 2^128 * i steps into the sequence (via the
+ *       xoshiro jump function), so streams never overlap and drawing from
+ *       one stream never shifts another.
+ */
+
+
+#ifndef _RDT_RANDOM_H_
+#define _RDT_RANDOM_H_
+
+#include <stdint.h>
+
+
+struct rdt_rng {
+    uint64_t s[4];
+};
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* next 64 random bits */
+static inline uint64_t rng_next(struct rdt_rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+/* a random number in [0,1) with 53 bits of precision */
+static inline double rng_uniform(struct rdt_rng *r)
+{
+    return (rng_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* advance the generator by 2^128 steps */
+static inline void rng_jump(struct rdt_rng *r)
+{
+    static const uint64_t jump[4] = {
+	0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+	0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    for (int i=0; i<4; i++)
+	for (int b=0; b<64; b++) {
+	    if (jump[i] & (1ULL << b)) {
+		s0 ^= r->s[0];
+		s1 ^= r->s[1];
+		s2 ^= r->s[2];
+		s3 ^= r->s[3];
+	    }
+	    rng_next(r);
+	}
+
+    r->s[0] = s0;
+    r->s[1] = s1;
+    r->s[2] = s2;
+    r->s[3] = s3;
+}
+
+/* seed stream number "stream" of the given seed */
+static inline void rng_seed(struct rdt_rng *r, uint64_t seed, int stream)
+{
+    /* splitmix64 expands the seed into a well mixed, non-zero state */
+    for (int i=0; i<4; i++) {
+	uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	r->s[i] = z ^ (z >> 31);
+    }
+
+    for (int i=0; i<stream; i++)
+	rng_jump(r);
+}
+
+#endif  /* _RDT_RANDOM_H_ */
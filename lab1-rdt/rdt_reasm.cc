@@ -0,0 +1,48 @@
+/*
+ * FILE: rdt_reasm.cc
+ * DESCRIPTION: Message reassembly at the receiver.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdt_reasm.h"
+
+
+void Reasm_Init(struct reasm_buffer *r, int capacity)
+{
+    r->data = (char *) malloc(capacity);
+    ASSERT(r->data);
+    r->size = 0;
+    r->capacity = capacity;
+}
+
+void Reasm_Free(struct reasm_buffer *r)
+{
+    free(r->data);
+    r->data = NULL;
+    r->size = r->capacity = 0;
+}
+
+void Reasm_Append(struct reasm_buffer *r, const char *data, int n)
+{
+    if (r->size + n>r->capacity) {
+	int capacity = r->capacity>0 ? r->capacity : 1;
+	while (capacity<r->size + n) capacity *= 2;
+	r->data = (char *) realloc(r->data, capacity);
+	ASSERT(r->data);
+	r->capacity = capacity;
+    }
+    memcpy(r->data + r->size, data, n);
+    r->size += n;
+}
+
+struct message Reasm_Message(const struct reasm_buffer *r)
+{
+    struct message msg;
+    msg.size = r->size;
+    msg.data = r->data;
+    return msg;
+}
@@ -0,0 +1,42 @@
+/*
+ * FILE: rdt_reasm.h
+ * DESCRIPTION: Message reassembly at the receiver.
+ *
+ *       Payloads are appended straight from the packet into one growable
+ *       buffer, so every delivered byte is copied once.  A finished message
+ *       is handed to the upper layer as a view of that buffer: the upper
+ *       layer must consume it before it returns, after which the buffer is
+ *       reused for the next message.  The buffer only grows (doubling), so
+ *       once it has reached the largest message size there are no more
+ *       allocations.
+ */
+
+
+#ifndef _RDT_REASM_H_
+#define _RDT_REASM_H_
+
+#include "rdt_struct.h"
+
+
+struct reasm_buffer {
+    char *data;
+    int size;               /* bytes of the message so far */
+    int capacity;
+};
+
+/* start with room for capacity bytes */
+void Reasm_Init(struct reasm_buffer *r, int capacity);
+
+/* release the buffer */
+void Reasm_Free(struct reasm_buffer *r);
+
+/* append n bytes to the message being reassembled */
+void Reasm_Append(struct reasm_buffer *r, const char *data, int n);
+
+/* the message reassembled so far, valid until the next call on r */
+struct message Reasm_Message(const struct reasm_buffer *r);
+
+/* start the next message, keeping the buffer */
+static inline void Reasm_Reset(struct reasm_buffer *r) { r->size = 0; }
+
+#endif  /* _RDT_REASM_H_ */
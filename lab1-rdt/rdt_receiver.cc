@@ -6,33 +6,123 @@
  *       situations.  In this implementation, the packet format is laid out as 
  *       the following:
  *       
- *       |<-  1 byte  ->|<-             the rest            ->|
- *       | payload size |<-             payload             ->|
- *
- *       The first byte of each packet indicates the size of the payload
- *       (excluding this single-byte header)
+ *       |<-  2 byte  ->|<-  1 byte  ->|<-  1 byte  ->|<-             the rest            ->|
+ *       |<- checksum ->| payload size |<-  seqnum  ->|<-             payload             ->|
+ * 
+ *       The payload size excludes the header.  This is header version v1;
+ *       rdt_header.h describes it together with v2, which widens the
+ *       sequence number to 16 bits, v3, which adds a 2-byte connection ID
+ *       to v2, and the layout of acks.
  */
 
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <list>
+#include <vector>
+#include <map>
 #include "rdt_struct.h"
 #include "rdt_receiver.h"
 #include "utils.h"
+#include "rdt_config.h"
+#include "rdt_metrics.h"
+#include "rdt_trace.h"
+#include "rdt_header.h"
+#include "rdt_reasm.h"
+#include "rdt_receiver_timer.h"
+#include "rdt_fec.h"
+#include "rdt_conn.h"
 
 
 
 
-static bool buffer_flag[SEQUNCE_SIZE] = {};
-static struct message * msg_buffer[SEQUNCE_SIZE] = {};
-static seq_nr_t expected_seq = 0;
-static std::list<struct message *> submit_buffer; 
+static const struct hdr_format *hdr = NULL;    /* header version in use */
+/* the receive window, shared by all connections: no smaller than the
+   send buffer, the most any sender can have outstanding, but a power of
+   two and at most hdr->max_window */
+static int window = 0;
+
+/* an out-of-order packet, payload inline; two cache lines */
+struct recv_slot {
+    char data[RDT_PKTSIZE - 4];     /* the largest payload of any format */
+    uint16_t size;
+    bool last;                      /* last packet of a message */
+} __attribute__((aligned(64)));
+
+/* the parity symbols of an FEC block */
+struct fec_block {
+    std::vector<unsigned char> parity;  /* the parity symbols, one after another */
+    std::vector<bool> have;             /* parity symbol j arrived */
+};
+
+/* one connection, see rdt_conn.h */
+struct receiver_conn {
+    int id;
+    /* out-of-order packets, indexed by sequence number modulo the window;
+       a slot holds a packet iff its bit in recv_valid is set.  allocated
+       once */
+    struct recv_slot *recv_slots;
+    std::vector<uint64_t> recv_valid;
+    int nheld;                  /* slots in use */
+    seq_nr_t expected_seq;
+    bool nak_sent;              /* selective repeat: expected_seq was nak'ed */
+    struct reasm_buffer reasm;  /* the message being reassembled */
+    int acks_owed;              /* in-order packets not acked yet */
+    /* forward error correction (rdt_config.fec, rdt_fec.h): the symbols
+       of the data packets received lately, indexed like recv_slots, and
+       the parity of the blocks that may still miss a packet, by the
+       unwrapped sequence number of their first packet, so that the oldest
+       come first and a block of the previous trip around the sequence
+       space is never taken for a new one.  the symbols are allocated once */
+    unsigned char *fec_syms;
+    std::vector<seq_nr_t> fec_seq;      /* the packet a symbol belongs to */
+    std::vector<bool> fec_valid;
+    std::map<long long, struct fec_block> fec_blocks;
+    long long fec_expected;     /* expected_seq, unwrapped */
+    seq_nr_t fec_synced;        /* expected_seq fec_expected is of */
+    bool fec_decoding;          /* rebuilt packets are being received */
+};
+
+static std::vector<struct receiver_conn *> conns;
+
+/* a new connection expecting its first packet */
+static struct receiver_conn *Conn_Open(int id){
+    struct receiver_conn *c = new receiver_conn();
+    c->id = id;
+    void *slots = NULL;
+    ASSERT(posix_memalign(&slots, 64, window * sizeof(struct recv_slot)) == 0);
+    c->recv_slots = (struct recv_slot *) slots;
+    c->recv_valid.assign(window / 64, 0);
+    Reasm_Init(&c->reasm, 4096);
+    if (rdt_config.fec) {
+        c->fec_syms = (unsigned char *) malloc(window * Header_SymbolSize(hdr));
+        ASSERT(c->fec_syms);
+        c->fec_seq.assign(window, 0);
+        c->fec_valid.assign(window, false);
+    }
+    return c;
+}
+
+static void Conn_Close(struct receiver_conn *c){
+    free(c->recv_slots);
+    Reasm_Free(&c->reasm);
+    free(c->fec_syms);
+    delete c;
+}
+
 /* receiver initialization, called once at the very beginning */
 void Receiver_Init()
 {
-    fprintf(stdout, "At %.2fs: receiver initializing ...\n", GetSimulationTime());
+    RDT_TRACE(TRACE_INFO, TR_RECEIVER_INIT, 0, 0);
+    hdr = Header_Format(rdt_config.header, rdt_config.checksum);
+    ASSERT(hdr);
+    ASSERT(hdr->max_payload <= (int) sizeof(conns[0]->recv_slots[0].data));
+    ASSERT(hdr->max_window % 64 == 0);
+    for (window = 64; window < hdr->max_window && window < rdt_config.send_buffer; )
+        window *= 2;
+    ASSERT(rdt_config.connections >= 1 && rdt_config.connections <= CONN_MAX);
+    for (int i = 0; i < rdt_config.connections; i++)
+        conns.push_back(Conn_Open(i));
 }
 
 /* receiver finalization, called once at the very end.
@@ -41,109 +131,376 @@ void Receiver_Init()
    memory you allocated in Receiver_init(). */
 void Receiver_Final()
 {
-    fprintf(stdout, "At %.2fs: receiver finalizing ...\n", GetSimulationTime());
+    RDT_TRACE(TRACE_INFO, TR_RECEIVER_FINAL, 0, 0);
+    for (size_t i = 0; i < conns.size(); i++)
+        Conn_Close(conns[i]);
+    conns.clear();
+}
+
+long long Receiver_ConnMemory()
+{
+    long long bytes = 0;
+    for (size_t i = 0; i < conns.size(); i++) {
+        struct receiver_conn *c = conns[i];
+        bytes += sizeof(*c) + window * sizeof(struct recv_slot) +
+                 c->recv_valid.capacity() * sizeof(uint64_t) + c->reasm.capacity;
+        if (rdt_config.fec)
+            bytes += window * Header_SymbolSize(hdr) +
+                     c->fec_seq.capacity() * sizeof(seq_nr_t) + c->fec_valid.capacity() / 8;
+        /* a tree node holds its entry and three links and a color */
+        for (std::map<long long, struct fec_block>::const_iterator it = c->fec_blocks.begin();
+             it != c->fec_blocks.end(); ++it)
+            bytes += sizeof(*it) + 4 * sizeof(void *) + it->second.parity.capacity() +
+                     it->second.have.capacity() / 8;
+    }
+    return bytes;
+}
+
+
+/* append an in-order payload to the message, deliver it on its last packet.
+   the upper layer gets a view of the reassembly buffer, no copy */
+static void SubmitMsg(struct receiver_conn *c, const char *data, int size, bool last_pkt){
+    Reasm_Append(&c->reasm, data, size);
+    if(last_pkt){
+        struct message msg = Reasm_Message(&c->reasm);
+        RDT_TRACE(TRACE_INFO, TR_DELIVER, msg.size, 0);
+        Receiver_ConnToUpperLayer(c->id, &msg);
+        Reasm_Reset(&c->reasm);
+    }
+}
+
+/* pass an in-order payload on.  a coalesced one is split into its
+   records, see rdt_header.h; the checksum has vouched for their lengths */
+static void Submit_Payload(struct receiver_conn *c, const char *data, int size, bool last_pkt){
+    if (!rdt_config.coalesce) {
+        SubmitMsg(c, data, size, last_pkt);
+        return;
+    }
+    int i = 0;
+    while (i < size) {
+        int len = (unsigned char) data[i] & RECORD_LEN;
+        bool end = (data[i] & RECORD_END) != 0;
+        ASSERT(i + 1 + len <= size);
+        SubmitMsg(c, data + i + 1, len, end);
+        i += 1 + len;
+    }
+}
+
+static inline bool Slot_Valid(struct receiver_conn *c, int i){
+    return (c->recv_valid[i >> 6] >> (i & 63)) & 1;
 }
 
+/* number of held (or, with held false, free) slots in a row from slot i
+   on, up to the end of the slot array; found a bitmap word at a time */
+static int Slot_Run(struct receiver_conn *c, int i, bool held = true){
+    int n = 0, nwords = c->recv_valid.size();
+    for (int w = i >> 6; w < nwords; w++) {
+        int bit = (i + n) & 63;
+        uint64_t stop = held ? ~(c->recv_valid[w] >> bit) : c->recv_valid[w] >> bit;
+        if (stop != 0 && bit + __builtin_ctzll(stop) < 64)
+            return n + __builtin_ctzll(stop);
+        n += 64 - bit;
+    }
+    return n;
+}
+
+/* like Slot_Run(), for the sequence numbers from expected_seq + offset on,
+   wrapping around the slot array up to the end of the window */
+static int Seq_Run(struct receiver_conn *c, int offset, bool held){
+    int n = 0;
+    while (offset + n < window) {
+        int i = (c->expected_seq + offset + n) % window;
+        int run = Slot_Run(c, i, held);
+        n += run;
+        if (i + run < window)
+            break;
+    }
+    return n < window - offset ? n : window - offset;
+}
+
+/* the held packets as SACK blocks, lowest first; returns the number */
+static int Sack_Blocks(struct receiver_conn *c, struct sack_block *blocks){
+    seq_nr_t space = hdr->seq_space;
+    int n = 0, found = 0;
+    /* expected_seq itself is never held */
+    int offset = 1;
+    while (found < c->nheld && n < SACK_MAX_BLOCKS) {
+        offset += Seq_Run(c, offset, false);
+        if (offset >= window)
+            break;
+        int run = Seq_Run(c, offset, true);
+        blocks[n].start = seq_add(c->expected_seq, offset, space);
+        blocks[n].end = seq_add(c->expected_seq, offset + run, space);
+        n++;
+        found += run;
+        offset += run;
+    }
+    return n;
+}
 
-void Ack_seq(seq_nr_t seq_num){
-    fprintf(stdout, "At %.2fs: Receiver: ack seq %d send \n", GetSimulationTime(), seq_num);
+/* ack packet: kind, the sequence number it refers to, and the cumulative
+   ack (the last in-order packet) so that a lost ack is covered by the next.
+   with rdt_config.sack it lists the packets held past a gap as well */
+static void Ack_seq(struct receiver_conn *c, seq_nr_t seq_num, int kind){
+    RDT_TRACE(TRACE_PACKET, TR_ACK_SEND, seq_num, kind);
     packet pkt;
-    pkt.data[2] = 0;
-    pkt.data[3] = seq_num; 
-    uint16_t checksum = crc_16((const unsigned char *)(pkt.data + 2), 2);
-    memcpy(pkt.data, &checksum, 2);
+    struct ack_header h;
+    h.conn = c->id;
+    h.kind = kind;
+    h.seq = seq_num;
+    h.cumack = seq_add(c->expected_seq, -1, hdr->seq_space);
+    h.nsack = rdt_config.sack && c->nheld > 0 ? Sack_Blocks(c, h.sack) : 0;
+    Header_PutAck(hdr, &pkt, &h);
     Receiver_ToLowerLayer(&pkt);
+    Metrics_AckSent();
+    /* the cumulative ack covers every packet a delayed ack owed */
+    if (c->acks_owed > 0) {
+        c->acks_owed = 0;
+        if (Receiver_isTimerSet(c->id))
+            Receiver_StopTimer(c->id);
+    }
+}
+
+/* ack the in-order packets so far with one cumulative ack */
+static void Ack_Owed(struct receiver_conn *c){
+    seq_nr_t last = seq_add(c->expected_seq, -1, hdr->seq_space);
+    Ack_seq(c, last, rdt_config.protocol == PROTO_SR ? ACK_SELECTIVE : ACK_CUMULATIVE);
+}
+
+/* delayed acks: an in-order packet arrived, ack it along with the next
+   ones once ack_every of them are owed or ack_delay has passed.  now acks
+   at once, when the packet closed a gap */
+static void Ack_Delayed(struct receiver_conn *c, bool now){
+    c->acks_owed++;
+    if (now || c->acks_owed >= rdt_config.ack_every)
+        Ack_Owed(c);
+    else if (!Receiver_isTimerSet(c->id))
+        Receiver_StartTimer(c->id, rdt_config.ack_delay);
+}
+
+/* the delayed ack of a connection is due */
+void Receiver_Timeout(int conn){
+    struct receiver_conn *c = conns[conn];
+    if (c->acks_owed > 0)
+        Ack_Owed(c);
 }
-static void SubmitMsg(struct message* msg, bool last_pkt){
-    ASSERT(msg);
-    if(last_pkt){// build msg and to upper layer
-        int size = 0;
-        for(auto message : submit_buffer){
-            size += message->size;
+
+/* deliver the held packets that follow expected_seq, freeing their slots */
+static void Drain_Slots(struct receiver_conn *c){
+    seq_nr_t space = hdr->seq_space;
+    int run;
+    /* a run can wrap past the end of the slot array, hence the loop */
+    while ((run = Slot_Run(c, c->expected_seq % window)) > 0) {
+        int i = c->expected_seq % window;
+        for (int k = i; k < i + run; k++) {
+            Submit_Payload(c, c->recv_slots[k].data, c->recv_slots[k].size, c->recv_slots[k].last);
+            c->recv_valid[k >> 6] &= ~(1ULL << (k & 63));
         }
-        size += msg->size;
-        struct message *final_msg = (struct message *) malloc(sizeof(struct message));
-        final_msg->size = size;
-        final_msg->data = (char *)malloc(size);
-        int cursor = 0;
-        for(auto& message :submit_buffer){
-            memcpy(final_msg->data+cursor, message->data, message->size);
-            cursor += message->size;
-            free(message->data);
-            free(message);
+        c->expected_seq = seq_add(c->expected_seq, run, space);
+        c->nheld -= run;
+    }
+}
+
+static void Receive_Data(struct receiver_conn *c, seq_nr_t seq_num, const char *payload,
+                         int size, bool last_pkt);
+
+/* keep the symbol of an in-window data packet, as the sender built it */
+static void FEC_Remember(struct receiver_conn *c, seq_nr_t seq_num, const char *payload,
+                         int size, bool last_pkt){
+    int len = Header_SymbolSize(hdr);
+    int i = seq_num % window;
+    unsigned char *sym = c->fec_syms + i * len;
+    sym[0] = (unsigned char)(size | (last_pkt ? 0x80 : 0));
+    memcpy(sym + 1, payload, size);
+    memset(sym + 1 + size, 0, len - 1 - size);
+    c->fec_seq[i] = seq_num;
+    c->fec_valid[i] = true;
+}
+
+/* the unwrapped sequence number of a packet near the window */
+static long long FEC_Unwrap(struct receiver_conn *c, seq_nr_t seq_num){
+    seq_nr_t space = hdr->seq_space;
+    c->fec_expected += seq_sub(c->expected_seq, c->fec_synced, space);
+    c->fec_synced = c->expected_seq;
+    seq_nr_t ahead = seq_sub(seq_num, c->expected_seq, space);
+    return ahead < space / 2 ? c->fec_expected + ahead
+                             : c->fec_expected - (long long) seq_sub(c->expected_seq, seq_num, space);
+}
+
+/* forget the parity of the blocks delivered in full */
+static void FEC_Prune(struct receiver_conn *c){
+    FEC_Unwrap(c, c->expected_seq);
+    while (!c->fec_blocks.empty() &&
+           c->fec_blocks.begin()->first + rdt_config.fec_k <= c->fec_expected)
+        c->fec_blocks.erase(c->fec_blocks.begin());
+}
+
+/* rebuild the missing packets of the block starting at first, if its
+   parity and the packets at hand suffice, and receive them as if they had
+   arrived; no retransmission is waited for */
+static void FEC_Recover(struct receiver_conn *c, long long first){
+    auto it = c->fec_blocks.find(first);
+    if (it == c->fec_blocks.end() || c->fec_decoding)
+        return;
+    seq_nr_t space = hdr->seq_space;
+    int k = rdt_config.fec_k;
+    int len = Header_SymbolSize(hdr);
+    int nparity = Fec_Parities(rdt_config.fec, rdt_config.fec_m);
+    unsigned char rebuilt[FEC_MAX_BLOCK][RDT_PKTSIZE];
+    unsigned char *data[FEC_MAX_BLOCK], *parity[FEC_MAX_BLOCK];
+    bool have[FEC_MAX_BLOCK], have_parity[FEC_MAX_BLOCK];
+    int missing = 0, present = 0;
+    for (int i = 0; i < k; i++) {
+        seq_nr_t seq = (seq_nr_t) (first + i) & (space - 1);
+        int slot = seq % window;
+        have[i] = c->fec_valid[slot] && c->fec_seq[slot] == seq;
+        data[i] = have[i] ? c->fec_syms + slot * len : rebuilt[i];
+        if (!have[i]) {
+            /* a packet delivered long enough ago for its symbol to be
+               gone cannot be rebuilt, nor is it needed */
+            if (first + i < c->fec_expected)
+                return;
+            missing++;
         }
-        memcpy(final_msg->data+cursor, msg->data, msg->size);
-        fprintf(stdout,"submiting \n");
-        Receiver_ToUpperLayer(final_msg);
-        free(msg->data);
-        free(msg);
-        submit_buffer.clear();
-    }else{
-        submit_buffer.push_back(msg);
     }
+    for (int j = 0; j < nparity; j++) {
+        parity[j] = &it->second.parity[j * len];
+        have_parity[j] = it->second.have[j];
+        present += have_parity[j];
+    }
+    if (missing == 0 || missing > present)
+        return;
+    if (!Fec_Decode(rdt_config.fec, k, rdt_config.fec_m, data, have,
+                    parity, have_parity, len))
+        return;
+    c->fec_blocks.erase(it);
+
+    c->fec_decoding = true;
+    for (int i = 0; i < k; i++) {
+        if (have[i])
+            continue;
+        int size = rebuilt[i][0] & 0x7f;
+        bool last_pkt = (rebuilt[i][0] & 0x80) != 0;
+        if (size <= 0 || size >= len)
+            continue;
+        Metrics_FecRecovered();
+        Receive_Data(c, (seq_nr_t) (first + i) & (space - 1), (const char *) rebuilt[i] + 1,
+                     size, last_pkt);
+    }
+    c->fec_decoding = false;
+}
+
+/* a parity packet arrived */
+static void FEC_Parity(struct receiver_conn *c, const struct parity_header *ph, const char *sym){
+    int nparity = Fec_Parities(rdt_config.fec, rdt_config.fec_m);
+    long long first = FEC_Unwrap(c, ph->first);
+    if (ph->index >= nparity || first + rdt_config.fec_k <= c->fec_expected)
+        return;
+    int len = Header_SymbolSize(hdr);
+    struct fec_block &b = c->fec_blocks[first];
+    if (b.parity.empty()) {
+        b.parity.assign(nparity * len, 0);
+        b.have.assign(nparity, false);
+    }
+    memcpy(&b.parity[ph->index * len], sym, len);
+    b.have[ph->index] = true;
+    FEC_Recover(c, first);
+    FEC_Prune(c);
+}
+
+/* a data packet arrived: its block may be complete enough now */
+static void FEC_Data(struct receiver_conn *c, seq_nr_t seq_num){
+    long long n = FEC_Unwrap(c, seq_num);
+    for (int i = 0; i < rdt_config.fec_k && !c->fec_blocks.empty(); i++)
+        FEC_Recover(c, n - i);
+    FEC_Prune(c);
 }
 
 /* event handler, called when a packet is passed from the lower layer at the 
    receiver */
 void Receiver_FromLowerLayer(struct packet *pkt)
 {
-    /* 2-byte header indicating the chsum */
-    /* 1-byte header indicating the size of the payload */
-    /* 1-byte header indicating sequence number  */
-    int header_size = 4;
-    /* construct a message and deliver to the upper layer */
-    struct message *msg = (struct message*) malloc(sizeof(struct message));
-    // if not using unsigned char , computation of this value will be signed and negative.
-    msg->size = (unsigned char) pkt->data[2];
-    int seq_num = pkt->data[3] & 127;
-    bool last_pkt = (pkt->data[3] & 128) != 0;
-    fprintf(stdout, "At %.2fs: Receiver: receive %d, expect %d, is last %d ，size %d\n", GetSimulationTime(), seq_num, expected_seq,last_pkt,msg->size);
-    /* sanity check in case the packet is corrupted */
-    // int checklength = (unsigned char)msg->size + 2;
-    int checklength = msg->size + 2;
-    // fprintf(stdout,"checklength,%d\n",checklength);
-    if ( *(uint16_t*)(pkt->data) != crc_16((const unsigned char *)pkt->data + 2,checklength))
+    /* checksum, payload size and sequence number, see rdt_header.h */
+    int header_size = hdr->data_header;
+    int nconns = conns.size();
+    /* sanity check in case the packet is corrupted, the header parser
+       checks the checksum and the size bounds */
+    struct data_header h;
+    if (!Header_GetData(hdr, pkt, &h) || h.conn >= nconns)
     {
-        fprintf(stdout, "At %.2fs: packet checksum mismatch\n", GetSimulationTime());
+        struct parity_header ph;
+        if (rdt_config.fec && Header_GetParity(hdr, pkt, &ph) && ph.conn < nconns) {
+            FEC_Parity(conns[ph.conn], &ph, pkt->data + hdr->parity_header);
+            return ;
+        }
+        RDT_TRACE(TRACE_PACKET, TR_RECV_CORRUPT, 0, 0);
         return ;
     }
-    // if msg size out of bounds. it will be detected by checksum.
-    ASSERT(msg->size > 0 && msg->size <= RDT_PKTSIZE-header_size);
+    struct receiver_conn *c = conns[h.conn];
+    RDT_TRACE(TRACE_PACKET, TR_RECV, h.seq, h.size);
+    Receive_Data(c, h.seq, pkt->data+header_size, h.size, h.last);
+    if (rdt_config.fec)
+        FEC_Data(c, h.seq);
+}
 
-    if(!between(expected_seq, seq_num,(expected_seq + WINDOW_SIZE)% SEQUNCE_SIZE)){
-        fprintf(stdout, "At %.2fs: Receiver: packet %d, no in region\n", GetSimulationTime(), seq_num);
-        Ack_seq((expected_seq - 1) % SEQUNCE_SIZE);
+/* a data packet, received or rebuilt from FEC parity */
+static void Receive_Data(struct receiver_conn *c, seq_nr_t seq_num, const char *payload,
+                         int size, bool last_pkt)
+{
+    seq_nr_t space = hdr->seq_space;
+    seq_nr_t expected_seq = c->expected_seq;
+    if(!between(expected_seq, seq_num, seq_add(expected_seq, window, space), space)){
+        RDT_TRACE(TRACE_PACKET, TR_RECV_OUTSIDE, seq_num, expected_seq);
+        Metrics_DuplicateDiscarded();
+        if (rdt_config.protocol == PROTO_SR) {
+            // already delivered, the sender must have missed our ack.
+            if (between(seq_add(expected_seq, -window, space), seq_num, expected_seq, space))
+                Ack_seq(c, seq_num, ACK_SELECTIVE);
+        } else
+            Ack_seq(c, seq_add(expected_seq, -1, space), ACK_CUMULATIVE);
         return ;
     }
-
-    /* send mesg to upper layer */
-    msg->data = (char*) malloc(msg->size);
-    ASSERT(msg->data);
-    memcpy(msg->data, pkt->data+header_size, msg->size);
+    if (rdt_config.fec)
+        FEC_Remember(c, seq_num, payload, size, last_pkt);
+    bool delayed = rdt_config.ack_every > 1;
+    if (rdt_config.protocol == PROTO_SR && !(delayed && seq_num == expected_seq))
+        Ack_seq(c, seq_num, ACK_SELECTIVE);
 
     if(seq_num == expected_seq){ // this seq num, update state.
-        SubmitMsg(msg,last_pkt);
-        inc(expected_seq, SEQUNCE_SIZE);
-        //flush receive buffer to msg slices.
-        while (msg_buffer[expected_seq] != nullptr)
-        {
-            SubmitMsg(msg_buffer[expected_seq], buffer_flag[expected_seq]);
-            msg_buffer[expected_seq] = nullptr;
-            buffer_flag[expected_seq] = false;
-            inc(expected_seq, SEQUNCE_SIZE);
-        }
+        bool filled = c->nheld > 0;
+        Submit_Payload(c, payload, size, last_pkt);
+        c->expected_seq = seq_add(expected_seq, 1, space);
+        //flush receive buffer to the message.
+        Drain_Slots(c);
+        c->nak_sent = false;
         //reply ack for this seqnum.
-        Ack_seq((expected_seq - 1) % SEQUNCE_SIZE);
+        if (delayed)
+            Ack_Delayed(c, filled);
+        else if (rdt_config.protocol == PROTO_GBN)
+            Ack_seq(c, seq_add(c->expected_seq, -1, space), ACK_CUMULATIVE);
         
     }else { // other seq num, store in buffer
-        if(msg_buffer[seq_num] == nullptr){
-            msg_buffer[seq_num] = msg;
-            buffer_flag[seq_num ] = last_pkt;
+        // selective repeat: a gap opened, ask for the missing packet once.
+        if (rdt_config.protocol == PROTO_SR && !c->nak_sent) {
+            Ack_seq(c, expected_seq, ACK_NAK);
+            c->nak_sent = true;
         }
-        else {
-            /* don't forget to free the space */
-            if (msg->data!=NULL) free(msg->data);
-            if (msg!=NULL) free(msg);
+        int i = seq_num % window;
+        if(!Slot_Valid(c, i)){
+            /* hold a copy of the payload until the gap is filled */
+            memcpy(c->recv_slots[i].data, payload, size);
+            c->recv_slots[i].size = size;
+            c->recv_slots[i].last = last_pkt;
+            c->recv_valid[i >> 6] |= 1ULL << (i & 63);
+            c->nheld++;
         }
+        else
+            Metrics_DuplicateDiscarded();
+        // go back n with SACK: tell the sender what is held past the gap;
+        // with fast retransmit the duplicate ack is the loss signal.  the
+        // acks a delayed ack owes go out now as well.
+        if (rdt_config.protocol == PROTO_GBN &&
+            (rdt_config.sack || rdt_config.fast_rtx != FRTX_OFF || c->acks_owed > 0))
+            Ack_seq(c, seq_add(c->expected_seq, -1, space), ACK_CUMULATIVE);
     }
 }
@@ -0,0 +1,33 @@
+/*
+ * FILE: rdt_receiver_timer.h
+ * DESCRIPTION: A timer for the rdt receiver.
+ *
+ *       rdt_receiver.h offers the receiver no timer, so it could only
+ *       react to arriving packets.  This is the receiver's counterpart of
+ *       Sender_StartTimer() and friends in rdt_sender.h, with the same
+ *       semantics: one timer per connection (rdt_conn.h), restarting it
+ *       replaces the pending expiry.  The receiver uses it to delay acks
+ *       (rdt_config.ack_every).
+ */
+
+
+#ifndef _RDT_RECEIVER_TIMER_H_
+#define _RDT_RECEIVER_TIMER_H_
+
+
+/* implemented by the simulator: start the receiver timer of connection
+   conn with a timeout (in seconds), cancelling the one already set.
+   Receiver_Timeout() is called when it expires */
+void Receiver_StartTimer(int conn, double timeout);
+
+/* implemented by the simulator: stop the receiver timer of a connection */
+void Receiver_StopTimer(int conn);
+
+/* implemented by the simulator: true if the receiver timer of a
+   connection is set */
+bool Receiver_isTimerSet(int conn);
+
+/* implemented by the receiver: the receiver timer of a connection expired */
+void Receiver_Timeout(int conn);
+
+#endif  /* _RDT_RECEIVER_TIMER_H_ */
@@ -0,0 +1,61 @@
+/*
+ * FILE: rdt_rto.cc
+ * DESCRIPTION: Retransmission timeout estimation (RFC 6298).
+ */
+
+
+#include <math.h>
+
+#include "rdt_rto.h"
+
+
+static double rto_clamp(double rto)
+{
+    if (rto<RTO_MIN) return RTO_MIN;
+    if (rto>RTO_MAX) return RTO_MAX;
+    return rto;
+}
+
+void Rto_Init(struct rto_estimator *e, double initial)
+{
+    e->srtt = 0;
+    e->rttvar = 0;
+    e->rto = rto_clamp(initial);
+    e->backoff = 0;
+    e->samples = 0;
+}
+
+void Rto_Sample(struct rto_estimator *e, double rtt)
+{
+    if (e->samples==0) {
+	e->srtt = rtt;
+	e->rttvar = rtt / 2;
+    }
+    else {
+	/* alpha = 1/8, beta = 1/4; rttvar first, it uses the old srtt */
+	e->rttvar += (fabs(e->srtt - rtt) - e->rttvar) / 4;
+	e->srtt += (rtt - e->srtt) / 8;
+    }
+    e->samples++;
+
+    double var = 4 * e->rttvar;
+    e->rto = rto_clamp(e->srtt + (var>RTO_GRANULARITY ? var : RTO_GRANULARITY));
+    e->backoff = 0;
+}
+
+void Rto_Backoff(struct rto_estimator *e)
+{
+    if (Rto_Timeout(e)<RTO_MAX) e->backoff++;
+}
+
+void Rto_Progress(struct rto_estimator *e)
+{
+    /* without a sample yet the initial timeout may be shorter than the
+       round trip; keep backing off until an ack can be timed (Karn) */
+    if (e->samples>0) e->backoff = 0;
+}
+
+double Rto_Timeout(const struct rto_estimator *e)
+{
+    return rto_clamp(ldexp(e->rto, e->backoff));
+}
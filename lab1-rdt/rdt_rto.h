@@ -0,0 +1,53 @@
+/*
+ * FILE: rdt_rto.h
+ * DESCRIPTION: Retransmission timeout estimation.
+ *
+ *       Jacobson/Karels: a smoothed round-trip time and its mean deviation
+ *       are updated from every valid RTT sample and the timeout is
+ *       srtt + 4*rttvar.  The caller applies Karn's rule, i.e. never takes a
+ *       sample from a packet that has been retransmitted, because its ack
+ *       cannot be matched to one transmission.
+ *
+ *       Timers run per packet, but the backoff is shared like TCP's single
+ *       timer: it doubles only when the oldest outstanding packet times out
+ *       (bumping it on every expiry would compound across the window), and
+ *       is kept for every packet sent afterwards.  Karn keeps it until the
+ *       next valid sample; here, as in QUIC, any ack of new data ends it,
+ *       since on a lossy link most acks release a retransmitted packet and
+ *       valid samples are rare.  Until the first sample it is kept, as the
+ *       initial timeout may be shorter than the round trip.
+ */
+
+
+#ifndef _RDT_RTO_H_
+#define _RDT_RTO_H_
+
+
+#define RTO_MIN         0.05    /* bounds of the timeout (in seconds) */
+#define RTO_MAX         60.0
+#define RTO_GRANULARITY 0.01    /* lower bound of the variance term */
+
+struct rto_estimator {
+    double srtt;            /* smoothed round-trip time */
+    double rttvar;          /* round-trip time mean deviation */
+    double rto;             /* current timeout, before backoff */
+    int backoff;            /* doublings since the last ack of new data */
+    long long samples;
+};
+
+/* reset the estimator, the timeout is initial until the first sample */
+void Rto_Init(struct rto_estimator *e, double initial);
+
+/* feed one round-trip time sample of a packet sent exactly once */
+void Rto_Sample(struct rto_estimator *e, double rtt);
+
+/* the oldest outstanding packet timed out, back off */
+void Rto_Backoff(struct rto_estimator *e);
+
+/* an ack acknowledged new data, end the backoff once an RTT is known */
+void Rto_Progress(struct rto_estimator *e);
+
+/* timeout including backoff */
+double Rto_Timeout(const struct rto_estimator *e);
+
+#endif  /* _RDT_RTO_H_ */
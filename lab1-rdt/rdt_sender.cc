@@ -10,88 +10,229 @@
  *       |<- checksum ->| payload size |<-  seqnum  ->|<-             payload             ->|
  * 
  *       The first byte of each packet indicates the size of the payload
- *       (excluding this single-byte header)
+ *       (excluding this single-byte header).  This is header version v1;
+ *       rdt_header.h describes it together with v2, which widens the
+ *       sequence number to 16 bits, and v3, which adds a 2-byte connection
+ *       ID to v2.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <list>
+#include <vector>
+#include <deque>
 #include "rdt_struct.h"
 #include "rdt_sender.h"
 #include "utils.h"
+#include "rdt_config.h"
+#include "rdt_metrics.h"
+#include "rdt_trace.h"
+#include "rdt_timer.h"
+#include "rdt_rto.h"
+#include "rdt_cc.h"
+#include "rdt_header.h"
+#include "rdt_backpressure.h"
+#include "rdt_fec.h"
+#include "rdt_conn.h"
 
-class Timer
-{
-public:
-    packet *pkt;
-    double expire;
-    bool done;
-    Timer(packet *p, double t, bool done)
-        : pkt(p), expire(t), done(done)
-    {}
+/* shared by all connections, they follow from rdt_config */
+const struct hdr_format *hdr = NULL;    /* header version in use */
+int max_payload = 0;            /* payload bytes of a data packet */
+int window_size = 0;
+int send_size = 0;
+int flush_timer = 0;            /* timer id of the flush timer */
+int fec_parities = 0;           /* parity packets per block */
+
+/* one connection, see rdt_conn.h */
+struct sender_conn {
+    int id;
+    seq_nr_t next_frame_to_send;
+    seq_nr_t next_ack;
+    seq_nr_t nbuffered;
+    seq_nr_t base_seq;          /* sequence number of the next_ack slot */
+    int nwaiting;               /* packets not sent yet (an estimate when
+                                   coalescing) */
+    /* the send buffer holds up to send_size packets: the nbuffered
+       outstanding ones, built in a ring of window_size slots from slot
+       next_ack on, and the nwaiting ones still in the messages they come
+       from.  a waiting packet is built (header, payload, checksum) only
+       when the window lets it go out.  the window holds up to
+       hdr->max_window packets, the congestion controller decides how many
+       of them may be outstanding.  packets are numbered consecutively, so
+       a slot's sequence number follows from its distance to next_ack */
+    std::vector<packet> send_window;
+    std::deque<struct message *> waiting_msgs;  /* owned, oldest first */
+    int waiting_cursor;         /* bytes of the oldest one already sent */
+    long long waiting_bytes;    /* bytes held in waiting_msgs */
+    std::vector<bool> acked;    /* selective repeat: slot acknowledged */
+    std::vector<double> first_sent;     /* time of the first transmission */
+    std::vector<double> last_sent;      /* time of the latest transmission */
+    std::vector<int> retries;   /* times retransmitted */
+    int blocked_need;           /* packets the refused message needs, 0 if none */
+    /* coalescing (rdt_config.coalesce): packets are filled with records
+       of as many waiting messages as fit, and go out once coalesce bytes
+       are waiting or the flush timer has expired */
+    bool flush_due;             /* the flush timer expired, send what waits */
+    /* duplicate acks (rdt_config.fast_rtx) */
+    int dupacks;                /* in a row for the oldest outstanding packet */
+    bool in_recovery;           /* fast recovery is running */
+    seq_nr_t recover_seq;       /* it ends once this packet is acked */
+    /* forward error correction (rdt_config.fec): the parity symbols of
+       the block being sent, see rdt_fec.h */
+    std::vector<unsigned char> fec_parity;
+    int fec_count;              /* data packets of the block so far */
+    seq_nr_t fec_first;         /* the block's first sequence number */
+    /* one retransmission timer per slot plus the flush timer, multiplexed
+       onto the connection's simulator timer which is always set for the
+       earliest of them */
+    TimerWheel *timers;
+    double timer_expire;        /* expiry the simulator timer is set for */
+    struct rto_estimator rto;
+    CongestionControl *cc;
+    /* the queues and window last reported, see Queues_Changed() */
+    int shown_buffered, shown_waiting, shown_cwnd;
 };
-seq_nr_t next_frame_to_send = 0;
-seq_nr_t next_ack = 0;
-seq_nr_t nbuffered = 0;
-packet sliding_window[WINDOW_SIZE];
-std::list<packet> waiting_buffer;
-std::list<Timer> timers;
-
-static seq_nr_t getSeqNum(packet *pkt)
-{
-    return (seq_nr_t)(pkt->data[3] & 127);
-}
-static void Add_Timer(packet *pkt, double expire)
-{
-    fprintf(stdout,"At %.2fs: start Timer %d, expire time %.2fs \n", GetSimulationTime(),getSeqNum(pkt), expire);
-    Timer timer = Timer(pkt, expire, false);
-    timers.push_back(timer);
-    // first timer set timeout .
-    if (timers.size() == 1 && !Sender_isTimerSet())
-        Sender_StartTimer(TIME_OUT);
-    
-}
-static void Remove_Timer(seq_nr_t seq_num)
-{
-    // printf("At %.2fs: Removing timer %d\n", GetSimulationTime(), seq_num);
-    // if next due timer is this timer. then pop out and pop out subsequent due timer, and start new timer.
-    
-    if (getSeqNum(timers.front().pkt) == seq_num)
-    {
-        printf("At %.2fs: remove front timer %d\n", GetSimulationTime(),seq_num);
-        Sender_StopTimer();
-        timers.pop_front();
-        while (!timers.empty())
-        {
-            if (timers.front().done)
-            {
-                timers.pop_front();
-            }
-            else
-            {
-                printf("At %.2fs: start Timer %d, left time %.2fs\n", GetSimulationTime(),
-                       getSeqNum(timers.front().pkt), timers.front().expire - GetSimulationTime());
-                Sender_StartTimer(timers.front().expire - GetSimulationTime());
-                break;
-            }
-        }
+
+std::vector<struct sender_conn *> conns;
+/* the metrics hooks see all connections together */
+int total_buffered = 0, total_waiting = 0, total_cwnd = 0;
+long long total_waiting_bytes = 0;
+
+static seq_nr_t Slot_Seq(struct sender_conn *c, int slot)
+{
+    int offset = (slot + window_size - c->next_ack) % window_size;
+    return seq_add(c->base_seq, offset, hdr->seq_space);
+}
+/* payload size of the packet in a slot, for tracing */
+static inline int Slot_Payload(struct sender_conn *c, int slot)
+{
+    struct data_header h;
+    return Header_GetData(hdr, &c->send_window[slot], &h) ? h.size : 0;
+}
+/* point the simulator timer at the earliest retransmission timer */
+static void Rearm_Timer(struct sender_conn *c)
+{
+    int slot = c->timers->next();
+    if (slot < 0)
+    {
+        if (Sender_isConnTimerSet(c->id))
+            Sender_StopConnTimer(c->id);
+        return;
     }
+    if (Sender_isConnTimerSet(c->id) && c->timer_expire == c->timers->expire(slot))
+        return;
+    c->timer_expire = c->timers->expire(slot);
+    RDT_TRACE(TRACE_TIMER, TR_TIMER_RESTART, Slot_Seq(c, slot), c->timer_expire - GetSimulationTime());
+    Sender_StartConnTimer(c->id, c->timer_expire - GetSimulationTime());
+}
+static void Add_Timer(struct sender_conn *c, int slot, double expire)
+{
+    RDT_TRACE(TRACE_TIMER, TR_TIMER_ADD, Slot_Seq(c, slot), expire);
+    c->timers->set(slot, expire);
+    Rearm_Timer(c);
+}
+static void Remove_Timer(struct sender_conn *c, int slot)
+{
+    RDT_TRACE(TRACE_TIMER, TR_TIMER_STOP, Slot_Seq(c, slot), 0);
+    c->timers->cancel(slot);
+    Rearm_Timer(c);
+}
+/* retransmission timeout for packets sent now */
+static double Timeout_Interval(struct sender_conn *c)
+{
+    return rdt_config.rto == RTO_ADAPTIVE ? Rto_Timeout(&c->rto) : TIME_OUT;
+}
+/* send the packet in a window slot to the lower layer and start its timer */
+static void Send_Slot(struct sender_conn *c, int slot, bool retransmission)
+{
+    double now = GetSimulationTime();
+    Sender_ToLowerLayer(&c->send_window[slot]);
+    Metrics_PacketSent(retransmission);
+    if (retransmission)
+        c->retries[slot]++;
     else
-    { // if next due timer isn't this timer, then mark this timer as done.
-        for (auto& timer : timers)
-        {
-            if (getSeqNum(timer.pkt) == seq_num){
-                printf("At %.2fs: mark timer done %d\n", GetSimulationTime(),seq_num);
-                timer.done = true;
-            }
-        }
+    {
+        c->first_sent[slot] = now;
+        c->retries[slot] = 0;
+    }
+    c->last_sent[slot] = now;
+    Add_Timer(c, slot, now + Timeout_Interval(c));
+}
+/* the packet in a window slot has been acknowledged */
+static void Slot_Acked(struct sender_conn *c, int slot)
+{
+    Rto_Progress(&c->rto);
+    c->cc->on_ack(1);
+    if (c->retries[slot] > 0)
+        Metrics_Recovered(GetSimulationTime() - c->first_sent[slot]);
+}
+
+/* report the queues of all connections after those of c changed */
+static void Queues_Changed(struct sender_conn *c)
+{
+    total_buffered += (int) c->nbuffered - c->shown_buffered;
+    total_waiting += c->nwaiting - c->shown_waiting;
+    c->shown_buffered = (int) c->nbuffered;
+    c->shown_waiting = c->nwaiting;
+    Metrics_SenderQueues(total_buffered, total_waiting);
+}
+/* likewise for the congestion windows */
+static void Window_Changed(struct sender_conn *c)
+{
+    total_cwnd += c->cc->window() - c->shown_cwnd;
+    c->shown_cwnd = c->cc->window();
+    Metrics_CongestionWindow(total_cwnd);
+}
+
+/* a new connection with nothing sent yet */
+static struct sender_conn *Conn_Open(int id)
+{
+    struct sender_conn *c = new sender_conn();
+    c->id = id;
+    c->send_window.resize(window_size);
+    c->acked.assign(window_size, false);
+    c->first_sent.resize(window_size);
+    c->last_sent.resize(window_size);
+    c->retries.resize(window_size);
+    c->fec_parity.assign(fec_parities * Header_SymbolSize(hdr), 0);
+    c->timers = new TimerWheel(window_size + 1);
+    Rto_Init(&c->rto, TIME_OUT);
+    c->cc = CC_Create(rdt_config.cc, WINDOW_SIZE, window_size);
+    return c;
+}
+
+static void Conn_Close(struct sender_conn *c)
+{
+    delete c->cc;
+    delete c->timers;
+    for (size_t i = 0; i < c->waiting_msgs.size(); i++)
+    {
+        free(c->waiting_msgs[i]->data);
+        free(c->waiting_msgs[i]);
     }
+    delete c;
 }
+
 /* sender initialization, called once at the very beginning */
 void Sender_Init()
 {
-    fprintf(stdout, "At %.2fs: sender initializing ...\n", GetSimulationTime());
+    RDT_TRACE(TRACE_INFO, TR_SENDER_INIT, 0, 0);
+    hdr = Header_Format(rdt_config.header, rdt_config.checksum);
+    ASSERT(hdr);
+    /* with FEC a payload and its size byte make up a symbol */
+    max_payload = rdt_config.fec ? Header_SymbolSize(hdr) - 1 : hdr->max_payload;
+    fec_parities = Fec_Parities(rdt_config.fec, rdt_config.fec_m);
+    send_size = rdt_config.send_buffer;
+    ASSERT(send_size > 0);
+    window_size = hdr->max_window < send_size ? hdr->max_window : send_size;
+    flush_timer = window_size;
+    ASSERT(rdt_config.connections >= 1 && rdt_config.connections <= CONN_MAX);
+    for (int i = 0; i < rdt_config.connections; i++)
+    {
+        conns.push_back(Conn_Open(i));
+        Window_Changed(conns[i]);
+    }
+    Metrics_SendBuffer(send_size * rdt_config.connections);
 }
 
 /* sender finalization, called once at the very end.
@@ -100,133 +241,470 @@ void Sender_Init()
    memory you allocated in Sender_init(). */
 void Sender_Final()
 {
-    fprintf(stdout, "At %.2fs: sender finalizing ...\n", GetSimulationTime());
+    RDT_TRACE(TRACE_INFO, TR_SENDER_FINAL, 0, 0);
+    for (size_t i = 0; i < conns.size(); i++)
+        Conn_Close(conns[i]);
+    conns.clear();
+}
+
+long long Sender_ConnMemory()
+{
+    long long bytes = 0;
+    for (size_t i = 0; i < conns.size(); i++)
+    {
+        struct sender_conn *c = conns[i];
+        bytes += sizeof(*c) + c->send_window.capacity() * sizeof(packet) +
+                 c->acked.capacity() / 8 +
+                 (c->first_sent.capacity() + c->last_sent.capacity()) * sizeof(double) +
+                 c->retries.capacity() * sizeof(int) + c->fec_parity.capacity() +
+                 c->timers->memory();
+    }
+    return bytes;
+}
+
+/* packets a message of size bytes is split into.  a coalesced message
+   may share its first and last packet, but each part of it takes a
+   record header */
+static int Packets_For(int size)
+{
+    int room = rdt_config.coalesce ? max_payload - 1 : max_payload;
+    return (size + room - 1) / room;
+}
+
+/* coalescing: waiting bytes, counting a record header per message */
+static int Coalesce_Pending(struct sender_conn *c)
+{
+    return c->waiting_bytes - c->waiting_cursor + c->waiting_msgs.size();
+}
+
+bool Sender_WouldBlock(int conn, int size)
+{
+    struct sender_conn *c = conns[conn];
+    int need = Packets_For(size);
+    /* a message larger than the whole buffer could never be taken */
+    ASSERT(need <= send_size);
+    if ((int) c->nbuffered + c->nwaiting + need <= send_size)
+        return false;
+    c->blocked_need = need;
+    return true;
+}
+
+/* tell the upper layer once the refused message fits */
+static void Check_Writable(struct sender_conn *c)
+{
+    if (c->blocked_need > 0 && (int) c->nbuffered + c->nwaiting + c->blocked_need <= send_size)
+    {
+        c->blocked_need = 0;
+        Sender_Writable(c->id);
+    }
+}
+
+/* resident bytes of the send buffers */
+static void Memory_Changed()
+{
+    Metrics_SenderMemory(conns.size() * window_size * (long long) sizeof(packet) +
+                         total_waiting_bytes);
+}
+
+/* the oldest waiting message is all built into packets */
+static void Release_Front(struct sender_conn *c)
+{
+    struct message *msg = c->waiting_msgs.front();
+    c->waiting_bytes -= msg->size;
+    total_waiting_bytes -= msg->size;
+    free(msg->data);
+    free(msg);
+    c->waiting_msgs.pop_front();
+    c->waiting_cursor = 0;
+    Memory_Changed();
+    if (c->waiting_msgs.empty() && c->timers->armed(flush_timer))
+        Remove_Timer(c, flush_timer);
+}
+
+/* fill a payload with records of the waiting messages, see rdt_header.h;
+   returns its size.  sets last if the final record ends a message */
+static int Build_Records(struct sender_conn *c, char *payload, bool *last)
+{
+    int size = 0;
+    /* a record needs its header and at least one byte */
+    while (!c->waiting_msgs.empty() && max_payload - size > 1)
+    {
+        struct message *msg = c->waiting_msgs.front();
+        int n = msg->size - c->waiting_cursor;
+        if (n > max_payload - size - 1)
+            n = max_payload - size - 1;
+        *last = c->waiting_cursor + n == msg->size;
+        payload[size] = (char)(n | (*last ? RECORD_END : 0));
+        memcpy(payload + size + 1, msg->data + c->waiting_cursor, n);
+        size += 1 + n;
+        c->waiting_cursor += n;
+        if (*last)
+            Release_Front(c);
+    }
+    return size;
+}
+
+/* build the next waiting packet in a window slot, its header in h,
+   releasing its message once the last packet of it is built */
+static void Build_Packet(struct sender_conn *c, int slot, struct data_header *h)
+{
+    packet *pkt = &c->send_window[slot];
+    h->conn = c->id;
+    h->seq = c->next_frame_to_send;
+    c->next_frame_to_send = seq_add(c->next_frame_to_send, 1, hdr->seq_space);
+    if (rdt_config.coalesce)
+    {
+        h->size = Build_Records(c, pkt->data + hdr->data_header, &h->last);
+        Header_PutData(hdr, pkt, h);
+        c->nwaiting = (Coalesce_Pending(c) + max_payload - 1) / max_payload;
+        if (c->waiting_msgs.empty())
+            c->flush_due = false;
+        return;
+    }
+
+    struct message *msg = c->waiting_msgs.front();
+    int payload_size = msg->size - c->waiting_cursor;
+    if (payload_size > max_payload)
+        payload_size = max_payload;
+
+    h->size = payload_size;
+    h->last = c->waiting_cursor + payload_size == msg->size; // last pkt
+    memcpy(pkt->data + hdr->data_header, msg->data + c->waiting_cursor, payload_size);
+    Header_PutData(hdr, pkt, h); // header and checksum in front.
+
+    c->waiting_cursor += payload_size;
+    if (h->last)
+        Release_Front(c);
+    c->nwaiting--;
+}
+
+/* add a data packet sent for the first time to the FEC block, and send
+   the block's parity packets once it is complete */
+static void FEC_Add(struct sender_conn *c, const packet *pkt, const struct data_header *h)
+{
+    int len = Header_SymbolSize(hdr);
+    if (c->fec_count == 0)
+    {
+        c->fec_first = h->seq;
+        memset(&c->fec_parity[0], 0, c->fec_parity.size());
+    }
+    unsigned char sym[RDT_PKTSIZE];
+    sym[0] = (unsigned char)(h->size | (h->last ? 0x80 : 0));
+    memcpy(sym + 1, pkt->data + hdr->data_header, h->size);
+    memset(sym + 1 + h->size, 0, len - 1 - h->size);
+    Fec_Add(rdt_config.fec, rdt_config.fec_m, c->fec_count, sym, len, &c->fec_parity[0]);
+    if (++c->fec_count < rdt_config.fec_k)
+        return;
+
+    for (int j = 0; j < fec_parities; j++)
+    {
+        packet parity;
+        struct parity_header ph;
+        ph.conn = c->id;
+        ph.first = c->fec_first;
+        ph.index = j;
+        memcpy(parity.data + hdr->parity_header, &c->fec_parity[j * len], len);
+        Header_PutParity(hdr, &parity, &ph);
+        Sender_ToLowerLayer(&parity);
+        Metrics_ParitySent();
+    }
+    c->fec_count = 0;
+}
+
+/* coalescing holds back a packet that is not full until the flush timer
+   says it has waited long enough */
+static bool May_Send(struct sender_conn *c)
+{
+    if (!rdt_config.coalesce || c->flush_due)
+        return true;
+    int threshold = rdt_config.coalesce < max_payload ? rdt_config.coalesce
+                                                           : max_payload;
+    return Coalesce_Pending(c) >= threshold;
+}
+
+/* send waiting packets while the congestion window allows */
+static void Send_Waiting(struct sender_conn *c)
+{
+    while ((int) c->nbuffered < c->cc->window() && c->nwaiting > 0 && May_Send(c))
+    {
+        int next_pkt = (c->next_ack + c->nbuffered) % window_size;
+        struct data_header h;
+        Build_Packet(c, next_pkt, &h);
+        c->acked[next_pkt] = false;
+        Send_Slot(c, next_pkt, false);
+        if (rdt_config.fec)
+            FEC_Add(c, &c->send_window[next_pkt], &h);
+        RDT_TRACE(TRACE_PACKET, TR_SEND, Slot_Seq(c, next_pkt), Slot_Payload(c, next_pkt));
+        c->nbuffered++;
+    }
+}
+
+void Sender_TakeMessage(int conn, struct message *msg)
+{
+    struct sender_conn *c = conns[conn];
+    /* the upper layer checks Sender_WouldBlock() first */
+    int npackets = Packets_For(msg->size);
+    ASSERT((int) c->nbuffered + c->nwaiting + npackets <= send_size);
+
+    /* nothing is copied or checksummed here, the packets are built from
+       the message as the window opens */
+    c->waiting_msgs.push_back(msg);
+    c->waiting_bytes += msg->size;
+    total_waiting_bytes += msg->size;
+    if (rdt_config.coalesce)
+    {
+        c->nwaiting = (Coalesce_Pending(c) + max_payload - 1) / max_payload;
+        if (!c->flush_due && !c->timers->armed(flush_timer))
+            Add_Timer(c, flush_timer, GetSimulationTime() + rdt_config.coalesce_delay);
+    }
+    else
+        c->nwaiting += npackets;
+    RDT_TRACE(TRACE_PACKET, TR_QUEUE, c->next_frame_to_send, c->nwaiting);
+    Memory_Changed();
+    Send_Waiting(c);
+    Queues_Changed(c);
 }
 
 /* event handler, called when a message is passed from the upper layer at the 
-   sender */
+   sender.  the message stays the caller's, so take a copy of it; it goes
+   out on connection 0 */
 void Sender_FromUpperLayer(struct message *msg)
 {
+    struct message *copy = (struct message *) malloc(sizeof(struct message));
+    ASSERT(copy);
+    copy->size = msg->size;
+    copy->data = (char *) malloc(msg->size);
+    ASSERT(copy->data);
+    memcpy(copy->data, msg->data, msg->size);
+    Sender_TakeMessage(0, copy);
+}
 
-    /* 2-byte header indicating the chsum */
-    /* 1-byte header indicating the size of the payload */
-    /* 1-byte header indicating sequence number  */
-    int header_size = 4;
+/* slot of an outstanding packet in the sliding window, -1 if seq_num is
+   not outstanding */
+static int Window_Slot(struct sender_conn *c, seq_nr_t seq_num)
+{
+    if (c->nbuffered == 0)
+        return -1;
+    seq_nr_t offset = seq_sub(seq_num, c->base_seq, hdr->seq_space);
+    if (offset >= c->nbuffered)
+        return -1;
+    return (c->next_ack + offset) % window_size;
+}
 
-    /* maximum payload size */
-    int maxpayload_size = RDT_PKTSIZE - header_size;
+/* a cumulative ack releases every packet up to seq_ack */
+static void GBN_Ack(struct sender_conn *c, seq_nr_t seq_ack)
+{
+    //forwarding to the next_pkt.
+    while(c->nbuffered > 0 && between(c->base_seq, seq_ack,
+                                      seq_add(c->base_seq, c->nbuffered, hdr->seq_space), hdr->seq_space)){
+        c->nbuffered--;
+        if (c->acked[c->next_ack])
+            c->acked[c->next_ack] = false;    // released by a SACK block before
+        else
+        {
+            Slot_Acked(c, c->next_ack);
+            Remove_Timer(c, c->next_ack);
+        }
+        inc(c->next_ack, window_size);
+        c->base_seq = seq_add(c->base_seq, 1, hdr->seq_space);
+    }
+}
 
-    /* split the message if it is too big */
+/* slide the window over its acknowledged prefix.  the oldest outstanding
+   packet is then one the receiver has not confirmed, whose retransmission
+   timer is still armed, so the window cannot fill up with packets that
+   have no timer while the ack that would release them is lost */
+static void Slide_Window(struct sender_conn *c)
+{
+    while (c->nbuffered > 0 && c->acked[c->next_ack])
+    {
+        c->acked[c->next_ack] = false;
+        c->nbuffered--;
+        inc(c->next_ack, window_size);
+        c->base_seq = seq_add(c->base_seq, 1, hdr->seq_space);
+    }
+}
 
-    /* reuse the same packet data structure */
-    packet pkt;
+/* selective repeat: an ack releases its own packet, the window slides over
+   the acknowledged prefix; a nak resends the packet right away */
+static void SR_Ack(struct sender_conn *c, int kind, seq_nr_t seq_num)
+{
+    int slot = Window_Slot(c, seq_num);
+    if (slot < 0 || c->acked[slot])
+        return;
 
-    /* the cursor always points to the first unsent byte in the message */
-    int cursor = 0;
-    while (msg->size - cursor > 0)
+    if (kind == ACK_NAK)
     {
-        int payload_size = msg->size - cursor > maxpayload_size ? maxpayload_size : msg->size - cursor;
+        RDT_TRACE(TRACE_PACKET, TR_RESEND, seq_num, 0);
+        Send_Slot(c, slot, true);
+        return;
+    }
+
+    c->acked[slot] = true;
+    Slot_Acked(c, slot);
+    Remove_Timer(c, slot);
+}
 
-        pkt.data[2] = payload_size;
-        pkt.data[3] = next_frame_to_send;
-        inc(next_frame_to_send,SEQUNCE_SIZE);
-        if (payload_size == msg->size - cursor)
+/* SACK blocks: the packets in them have arrived, so they are done with
+   their timers and a timeout resends only the holes between them.  they
+   leave the window once every packet before them has been acked */
+static void SACK_Ack(struct sender_conn *c, const struct ack_header *h)
+{
+    for (int i = 0; i < h->nsack; i++)
+    {
+        seq_nr_t n = seq_sub(h->sack[i].end, h->sack[i].start, hdr->seq_space);
+        for (seq_nr_t k = 0; k < n; k++)
         {
-            pkt.data[3] |= (1<<7); // last pkt
+            int slot = Window_Slot(c, seq_add(h->sack[i].start, k, hdr->seq_space));
+            if (slot < 0 || c->acked[slot])
+                continue;
+            c->acked[slot] = true;
+            Slot_Acked(c, slot);
+            Remove_Timer(c, slot);
         }
-        memcpy(pkt.data + header_size, msg->data + cursor, payload_size); // copy data to packet payload
-        uint16_t checksum = crc_16((unsigned const char *)(pkt.data + 2), payload_size + 2);
-        memcpy(pkt.data, &checksum, 2); // copy checksum to packet front.
-        // pkt ready, send it out. if buffered pkt not reach limit, send it and set timer.
-        if (nbuffered < WINDOW_SIZE && waiting_buffer.size() == 0)
+    }
+}
+
+/* duplicate acks: an ack whose cumulative ack stays just below the window
+   says a packet past a hole has arrived.  the third in a row resends the
+   oldest outstanding packet without waiting for its timer.  in fast
+   recovery every ack that moves the window but stops short of
+   recover_seq (a partial ack) resends the next hole as well */
+static void Dup_Ack(struct sender_conn *c, bool dup, bool advanced)
+{
+    double now = GetSimulationTime();
+    if (advanced)
+    {
+        c->dupacks = 0;
+        if (!c->in_recovery)
+            return;
+        if (Window_Slot(c, c->recover_seq) < 0)
         {
-            int next_pkt = (next_ack + nbuffered) % WINDOW_SIZE;
-            sliding_window[next_pkt] = pkt;
-            /* send it out through the lower layer */
-            Sender_ToLowerLayer(&sliding_window[next_pkt]);
-            fprintf(stdout, "At %.2fs: sending pkt %d to lower layer,size %d\n",  GetSimulationTime(),getSeqNum(&sliding_window[next_pkt]),payload_size);
-            Add_Timer(&sliding_window[next_pkt], GetSimulationTime() + TIME_OUT);
-            nbuffered += 1;
+            c->in_recovery = false;
+            return;
         }
-        else
-        { // store the pkt in the waiting buffer, and send it when window moves.
-            fprintf(stdout, "At %.2fs: push pkt %d to waiting buffer\n",  GetSimulationTime(), getSeqNum(&pkt));
-            waiting_buffer.push_back(pkt);
+        if (!c->acked[c->next_ack])
+        {
+            RDT_TRACE(TRACE_PACKET, TR_RESEND, c->base_seq, 0);
+            Send_Slot(c, c->next_ack, true);
+            Metrics_FastRetransmit();
         }
-        /* move the cursor */
-        cursor += maxpayload_size;
+        return;
     }
+    if (!dup || ++c->dupacks != DUPACK_THRESHOLD || c->in_recovery || c->acked[c->next_ack])
+        return;
+    RDT_TRACE(TRACE_PACKET, TR_RESEND, c->base_seq, 0);
+    Send_Slot(c, c->next_ack, true);
+    Metrics_FastRetransmit();
+    c->cc->on_loss(rdt_config.fast_rtx == FRTX_RETRANSMIT, now);
+    if (rdt_config.fast_rtx == FRTX_RECOVERY)
+    {
+        c->in_recovery = true;
+        c->recover_seq = seq_add(c->base_seq, c->nbuffered - 1, hdr->seq_space);
+    }
+}
+
+/* round-trip time sample from the ack of seq_num.  Karn's rule: a packet
+   sent more than once gives no sample, the ack may belong to any copy.  a
+   cumulative ack releasing a retransmitted packet gives none either, it was
+   held back until the retransmission filled the hole */
+static void RTT_Sample(struct sender_conn *c, seq_nr_t seq_num, bool cumulative)
+{
+    int slot = Window_Slot(c, seq_num);
+    if (slot < 0 || c->acked[slot] || c->retries[slot] > 0)
+        return;
+    for (int s = c->next_ack; cumulative && s != slot; s = (s + 1) % window_size)
+        if (c->retries[s] > 0)
+            return;
+    double rtt = GetSimulationTime() - c->last_sent[slot];
+    Rto_Sample(&c->rto, rtt);
+    c->cc->on_rtt(rtt, GetSimulationTime());
+    Metrics_RttSample(rtt, c->rto.rto);
 }
 
 /* event handler, called when a packet is passed from the lower layer at the 
    sender */
 void Sender_FromLowerLayer(struct packet *pkt)
 {
-    fprintf(stderr, "At %.2fs: ack packet %d received\n", GetSimulationTime(), getSeqNum(pkt));
-    if (*(uint16_t *)(pkt->data) != crc_16( (const unsigned char *)(pkt->data + 2), 2))
+    struct ack_header h;
+    if (!Header_GetAck(hdr, pkt, &h) || h.conn >= (int) conns.size())
     {
-        if(pkt->data[2] != '0') {
-            fprintf(stdout,"shit %d, %d\n",pkt->data[2],pkt->data[2] - '0' );
-            fprintf(stderr, "%d,%d,%d,%d\n", pkt->data[0],pkt->data[1],pkt->data[2],pkt->data[3]);
-        }
-        fprintf(stderr, "At %.2fs: ack packet checksum mismathc\n", GetSimulationTime());
+        RDT_TRACE(TRACE_PACKET, TR_ACK_CORRUPT, 0, 0);
         return;
     }
-    seq_nr_t seq_ack = getSeqNum(pkt);
-    fprintf(stdout, "At %.2fs: receive packet %d ack\n", GetSimulationTime(), seq_ack);
-    //forwarding to the next_pkt.
-    while(nbuffered > 0 && between(getSeqNum(&sliding_window[next_ack]), seq_ack, 
-                                        (getSeqNum(&sliding_window[(next_ack + nbuffered - 1) % WINDOW_SIZE]) + 1) % SEQUNCE_SIZE )){
-        nbuffered--;
-        Remove_Timer(getSeqNum(&sliding_window[next_ack]));
-        inc(next_ack, WINDOW_SIZE);
+    struct sender_conn *c = conns[h.conn];
+    seq_nr_t seq_ack = h.seq;
+    int kind = h.kind;
+    RDT_TRACE(TRACE_PACKET, TR_ACK, seq_ack, kind);
+    if (rdt_config.protocol == PROTO_SR)
+    {
+        if (kind == ACK_SELECTIVE)
+            RTT_Sample(c, seq_ack, false);
     }
+    else
+        RTT_Sample(c, h.cumack, true);
+    bool dup = c->nbuffered > 0 && h.cumack == seq_add(c->base_seq, -1, hdr->seq_space);
+    seq_nr_t old_base = c->base_seq;
+    // every ack carries the receiver's cumulative ack as well.
+    GBN_Ack(c, h.cumack);
+    if (rdt_config.fast_rtx != FRTX_OFF)
+        Dup_Ack(c, dup, c->base_seq != old_base);
+    if (rdt_config.protocol == PROTO_SR)
+        SR_Ack(c, kind, seq_ack);
+    SACK_Ack(c, &h);
+    Slide_Window(c);
     //emptying the waiting buffer
-    while (nbuffered < WINDOW_SIZE && !waiting_buffer.empty()){
-        int next_pkt = (next_ack + nbuffered ) % WINDOW_SIZE;
-        sliding_window[next_pkt] = waiting_buffer.front();
-        waiting_buffer.pop_front();
-        // send pakcet and inc nbuffered.
-        Sender_ToLowerLayer(&sliding_window[next_pkt]);
-        fprintf(stdout, "At %.2fs: sending pkt %d to lower layer\n", GetSimulationTime(),getSeqNum(&sliding_window[next_pkt]));
-        Add_Timer(&sliding_window[next_pkt], GetSimulationTime() + TIME_OUT);
-        nbuffered ++ ;
-    }
+    Send_Waiting(c);
+    Queues_Changed(c);
+    Window_Changed(c);
+    Check_Writable(c);
     // Remove_Timer(seq_ack);
 }
 
+/* event handler, called when the timer of a connection expires */
+void Sender_ConnTimeout(int conn)
+{
+    struct sender_conn *c = conns[conn];
+    double now = GetSimulationTime();
+    int slot;
+    // the flush timer shares the wheel, its expiry is no loss.
+    bool flush = c->timers->armed(flush_timer) && c->timers->expire(flush_timer) <= now;
+    if (flush)
+    {
+        c->timers->cancel(flush_timer);
+        c->flush_due = true;
+    }
+    slot = c->timers->next();
+    if (!flush || (slot >= 0 && c->timers->expire(slot) <= now))
+    {
+        Metrics_Timeout();
+        c->cc->on_loss(true, now);
+        c->dupacks = 0;
+        c->in_recovery = false;
+    }
+    // resend every packet whose timer is due, oldest first.
+    while ((slot = c->timers->pop_expired(now)) >= 0)
+    {
+        RDT_TRACE(TRACE_PACKET, TR_TIMEOUT, Slot_Seq(c, slot), 0);
+        if (slot == (int) c->next_ack)
+            Rto_Backoff(&c->rto);
+        Sender_ToLowerLayer(&c->send_window[slot]);
+        Metrics_PacketSent(true);
+        c->retries[slot]++;
+        c->last_sent[slot] = now;
+        c->timers->set(slot, now + Timeout_Interval(c));
+    }
+    if (flush)
+    {
+        Send_Waiting(c);
+        Queues_Changed(c);
+    }
+    Rearm_Timer(c);
+    Window_Changed(c);
+}
+
 /* event handler, called when the timer expires */
 void Sender_Timeout()
 {
-    Timer timer = timers.front();
-    timers.pop_front();
-    int seq_num = getSeqNum(timer.pkt);
-    // resend it 
-    /* send it out through the lower layer */
-    Sender_ToLowerLayer(timer.pkt);
-    fprintf(stdout, "At %.2fs: timeout and resending pkt %d to lower layer\n", GetSimulationTime(), seq_num);
-    Add_Timer(timer.pkt, GetSimulationTime() + TIME_OUT);
-    // update timer
-    while(!timers.empty()){
-        if(timers.front().done){
-            fprintf(stdout, "At %.2fs: pop out timer for pkt %d\n", GetSimulationTime(), getSeqNum(timers.front().pkt));
-            timers.pop_front();
-        }else {
-            fprintf(stdout, "At %.2fs: restart timer for pkt %d, rest time %.2f\n", GetSimulationTime(), getSeqNum(timers.front().pkt),
-                    timers.front().expire-GetSimulationTime());
-            double rest_time = timers.front().expire-GetSimulationTime();
-            if(rest_time > 0){
-                Sender_StartTimer(rest_time);
-                return;
-            }else {
-                packet *pkt = timers.front().pkt;
-                timers.pop_front();
-                fprintf(stdout, "At %.2fs: resending pkt %d to lower layer\n", GetSimulationTime(), getSeqNum(pkt));
-                Sender_ToLowerLayer(pkt);
-                Add_Timer(pkt,GetSimulationTime() + TIME_OUT);
-            }
-        }
-    }
-    // Remove_Timer(seq_num);
-    
+    Sender_ConnTimeout(0);
 }
@@ -11,79 +11,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 #include "rdt_struct.h"
+#include "rdt_event.h"
+#include "rdt_sim.h"
+#include "rdt_random.h"
+#include "rdt_metrics.h"
+#include "rdt_trace.h"
+#include "rdt_config.h"
+#include "rdt_cc.h"
+#include "rdt_header.h"
+#include "rdt_fec.h"
+#include "rdt_link.h"
+#include "rdt_impair.h"
+#include "rdt_backpressure.h"
 #include "rdt_sender.h"
 #include "rdt_receiver.h"
-
-
-/*[]------------------------------------------------------------------------[]
-  |  generic event chain framework
-  []------------------------------------------------------------------------[]*/
-
-/* simulation event base class */
-class Event
-{
-public:
-    double sched_time;      /* scheduled occuring time */
-    int event_type;         /* application-specific event type */
-    class Event *next;      /* next event in the chain */
-
-public:
-    Event() { next = NULL; }
-};
-
-/* event chain class - the simulation core */
-class EventChain
-{
-public:
-    double sim_time;        /* simulation time */
-    Event *head;            /* head event in the chain */
-
-public:
-    EventChain() {
-	sim_time = 0;
-	head = NULL;
-    }
-    
-    double time() { return sim_time; }
-    
-    /* schedule an event - the event chain is maintained on an increasing order 
-       of sched_time */
-    void schedule(Event *e) {
-	/* do nothing if the event is schedule for the past */
-	if (e->sched_time<sim_time) return;
-
-	Event **ppcur = &head;
-	while ((*ppcur!=NULL) && ((*ppcur)->sched_time<=e->sched_time))
-	    ppcur = &((*ppcur)->next);
-
-	e->next = *ppcur;
-	*ppcur = e;
-    }
-
-    /* cancel an event scheduled for happening in the future */
-    void cancel(Event *e) {
-	Event **ppcur = &head;
-	while ((*ppcur!=NULL) && (*ppcur!=e))
-	    ppcur = &((*ppcur)->next);
-
-	if (*ppcur==e) *ppcur=(*ppcur)->next;
-    }
-
-    /* advance to the next event */
-    Event *next_event() {
-	if (head==NULL) return NULL;
-
-	Event *e = head;
-	head = head->next;
-	sim_time = e->sched_time;
-
-	return e;
-    }
-};
+#include "rdt_receiver_timer.h"
+#include "rdt_conn.h"
+#include "rdt_pdes.h"
 
 
 /*[]------------------------------------------------------------------------[]
@@ -91,19 +46,22 @@ public:
   []------------------------------------------------------------------------[]*/
 
 enum {EVENT_SENDER_FROMUPPERLAYER=0, EVENT_SENDER_FROMLOWERLAYER, 
-      EVENT_SENDER_TIMEOUT, EVENT_RECEIVER_FROMLOWERLAYER};
+      EVENT_SENDER_TIMEOUT, EVENT_RECEIVER_FROMLOWERLAYER,
+      EVENT_RECEIVER_TIMEOUT};
 
 /* the event that the upper layer at the sender instructs rdt layer to send out 
    a message */
-class EventSenderFromUpperLayer : public Event
+class EventSenderFromUpperLayer : public PooledEvent<EventSenderFromUpperLayer>
 {
+public:
+    int conn;
 public:
     EventSenderFromUpperLayer() { event_type = EVENT_SENDER_FROMUPPERLAYER; }
 };
 
 /* the event that the lower layer at the sender informs the rdt layer that a 
    packet is received from the link */
-class EventSenderFromLowerLayer : public Event
+class EventSenderFromLowerLayer : public PooledEvent<EventSenderFromLowerLayer>
 {
 public:
     struct packet pkt;
@@ -112,15 +70,17 @@ public:
 };
 
 /* the event that the timer at the sender expires */
-class EventSenderTimeout : public Event
+class EventSenderTimeout : public PooledEvent<EventSenderTimeout>
 {
+public:
+    int conn;
 public:
     EventSenderTimeout() { event_type = EVENT_SENDER_TIMEOUT; }
 };
 
 /* the event that the lower layer at the receiver informs the rdt layer that a 
    packet is received from the link */
-class EventReceiverFromLowerLayer : public Event
+class EventReceiverFromLowerLayer : public PooledEvent<EventReceiverFromLowerLayer>
 {
 public:
     struct packet pkt;
@@ -128,6 +88,15 @@ public:
     EventReceiverFromLowerLayer() { event_type = EVENT_RECEIVER_FROMLOWERLAYER; }
 };
 
+/* the event that the timer at the receiver expires */
+class EventReceiverTimeout : public PooledEvent<EventReceiverTimeout>
+{
+public:
+    int conn;
+public:
+    EventReceiverTimeout() { event_type = EVENT_RECEIVER_TIMEOUT; }
+};
+
 
 /*[]------------------------------------------------------------------------[]
   |  gloabal variables, statistics, etc.
@@ -143,8 +112,8 @@ double msg_arrivalint;
 /* average size of messages (in bytes) */
 int msg_size;
 
-/* average one-way packet delivery latency, set to be 100ms */
-const double pkt_latency = 0.1;
+/* average one-way packet delivery latency, 100ms by default */
+double pkt_latency = 0.1;
 
 /* the probability that a packet is not delivered with the normal latency:
    a value of 0.1 means that one in ten packets are not delivered with the 
@@ -167,16 +136,94 @@ double corrupt_rate;
 */
 int tracing_level;
 
+/* event chain scheduler backend, see rdt_event.h */
+int sched_kind = SCHED_HEAP4;
+
+/* configuration shared by the sender and the receiver */
+struct rdt_config rdt_config = {PROTO_GBN, RTO_FIXED, CC_FIXED, HDR_V1, CSUM_CRC16, SEND_BUFFER,
+                             false, 1, ACK_DELAY, 0, COALESCE_DELAY, FRTX_OFF,
+                             FEC_OFF, FEC_K, FEC_M, 1};
+
 /* simulation event chain core */
 EventChain sim_core;
 
-/* sender timer event */
-Event *sender_timer = NULL;
+/* logical processes, see rdt_pdes.h.  the sequential run keeps the events
+   of both in sim_core, with --pdes the receiver's are in receiver_core */
+enum {LP_SENDER=0, LP_RECEIVER, LP_NUM};
 
-/* general statistics */
-int tot_chars_sent = 0;
-int tot_chars_delivered = 0;
-int tot_pkts_passed = 0;
+/* a packet on its way to the other logical process */
+struct lp_arrival {
+    double time;
+    double created;
+    unsigned long long seq;
+    struct packet pkt;
+};
+
+struct sim_lp {
+    int id;
+    EventChain *core;               /* its pending events */
+    unsigned long long nscheduled;  /* events it has scheduled */
+    unsigned long long events;      /* events it has processed */
+    long long pkts_passed;          /* packets it put on the link */
+    /* pdes only */
+    SpscQueue<struct lp_arrival> channel;   /* packets arriving from the peer */
+    std::atomic<double> promise;    /* no packet it sends arrives earlier */
+    unsigned long long rounds;      /* synchronization rounds */
+    double busy;                    /* CPU time spent running events */
+    struct event_pool_stats pool;   /* event allocations of its thread */
+};
+static struct sim_lp lps[LP_NUM];
+static thread_local struct sim_lp *lp;      /* the one this thread runs */
+static EventChain receiver_core;
+static bool pdes;
+static double lookahead;
+/* busy logical processes plus packets in the channels */
+static std::atomic<long long> pdes_pending;
+
+/* the bottleneck link in each direction, see rdt_link.h */
+static struct link link_s2r, link_r2s;
+
+/* the loss and delay model of each direction, see rdt_impair.h.  the trace
+   model replays impair_trace, a recording run logs into impair_log */
+static struct impair impair_s2r, impair_r2s;
+static std::vector<uint16_t> impair_trace[2];
+static const char *impair_trace_path;
+static std::vector<uint16_t> impair_log[2];
+
+/* the ends of a connection as the simulator sees them, see rdt_conn.h */
+struct sim_conn {
+    Event *sender_timer;            /* sender timer event */
+    Event *receiver_timer;          /* receiver timer event */
+    /* the message arrival event and its message while the sender's buffer
+       is full, see rdt_backpressure.h */
+    Event *blocked_arrival;
+    struct message *blocked_msg;
+    double blocked_since;
+    char sent_cnt;                  /* the next character generated */
+    char delivered_cnt;             /* the next character expected */
+};
+static std::vector<struct sim_conn> conns;
+
+/* general statistics, summed over the logical processes at the end */
+long long tot_chars_sent = 0;
+long long tot_chars_delivered = 0;
+long long tot_pkts_passed = 0;
+
+/* simulator performance statistics */
+unsigned long long tot_events = 0;
+
+/* independent random streams, one per decision so that changing one
+   parameter (say the loss rate) does not perturb any other stream.  the
+   link streams are laid out per direction: RNG_S2R + LINK_LOSS is the loss
+   decision of packets from the sender to the receiver.  the red drop
+   decisions of the link queues and the state changes of the
+   gilbert-elliott model come last, so the other streams keep their
+   numbers */
+enum {LINK_LOSS=0, LINK_CORRUPT, LINK_NOISE, LINK_REORDER, LINK_DELAY, LINK_NUM};
+enum {RNG_MSG_SIZE=0, RNG_MSG_ARRIVAL, RNG_RANDTEST,
+      RNG_S2R, RNG_R2S = RNG_S2R + LINK_NUM, RNG_RED_S2R = RNG_R2S + LINK_NUM,
+      RNG_RED_R2S, RNG_GE_S2R, RNG_GE_R2S, RNG_NUM};
+static struct rdt_rng rng[RNG_NUM];
 
 /* error flag set by message verification at the receiver */
 bool message_verfication_passed = true;
@@ -186,22 +233,90 @@ bool message_verfication_passed = true;
   |  simulation routines
   []------------------------------------------------------------------------[]*/
 
-/* generate a random number in [0,1] */
-static double myrandom()
+/* wall-clock time (in seconds), for simulator performance statistics */
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* CPU time of the calling thread (in seconds), for the work of a logical
+   process */
+static double thread_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static const char *protocol_names[PROTO_NUM] = {"gbn", "sr"};
+
+/* protocol by name, -1 if there is no such protocol */
+int Protocol_Parse(const char *name)
+{
+    for (int i=0; i<PROTO_NUM; i++)
+	if (strcmp(name, protocol_names[i])==0) return i;
+    return -1;
+}
+
+/* name of a protocol */
+const char *Protocol_Name(int protocol)
+{
+    if (protocol<0 || protocol>=PROTO_NUM) return "unknown";
+    return protocol_names[protocol];
+}
+
+static const char *rto_names[RTO_NUM] = {"fixed", "adaptive"};
+
+/* timeout policy by name, -1 if there is no such policy */
+int Rto_Parse(const char *name)
 {
-    return(rand()*1.0/RAND_MAX);
+    for (int i=0; i<RTO_NUM; i++)
+	if (strcmp(name, rto_names[i])==0) return i;
+    return -1;
+}
+
+/* name of a timeout policy */
+const char *Rto_Name(int rto)
+{
+    if (rto<0 || rto>=RTO_NUM) return "unknown";
+    return rto_names[rto];
+}
+
+static const char *fast_rtx_names[FRTX_NUM] = {"off", "retransmit", "recovery"};
+
+/* duplicate ack policy by name, -1 if there is no such policy */
+int FastRtx_Parse(const char *name)
+{
+    for (int i=0; i<FRTX_NUM; i++)
+	if (strcmp(name, fast_rtx_names[i])==0) return i;
+    return -1;
+}
+
+/* name of a duplicate ack policy */
+const char *FastRtx_Name(int fast_rtx)
+{
+    if (fast_rtx<0 || fast_rtx>=FRTX_NUM) return "unknown";
+    return fast_rtx_names[fast_rtx];
+}
+
+/* generate a random number in [0,1) from one of the streams */
+static inline double myrandom(int stream)
+{
+    return rng_uniform(&rng[stream]);
 }
 
 /* generate a message 
    NOTE: change this part if you want to generate different messages for 
          testing.  we will certainly use different messages in our grading! */
-static struct message *generate_msg()
+static struct message *generate_msg(int conn)
 {
-    static char cnt = 0;
+    char &cnt = conns[conn].sent_cnt;
 
     struct message *msg = (struct message*) malloc(sizeof(struct message));
     ASSERT(msg!=NULL);
-    msg->size = (int)(myrandom()*2.0*msg_size);
+    msg->size = (int)(myrandom(RNG_MSG_SIZE)*2.0*msg_size);
     if (msg->size==0) msg->size=1;
     msg->data = (char*) malloc(msg->size);
     ASSERT(msg->data!=NULL);
@@ -212,126 +327,241 @@ static struct message *generate_msg()
     }
 
     tot_chars_sent += msg->size;
+    Metrics_MessageSent(conn, msg->size);
 
     return msg;
 }
 
-/* free the space of a message */
-static void free_msg(struct message *msg)
+/* the tie-breaking seq of the next event the logical process on this
+   thread schedules.  the process id in the high bits orders the events
+   the two processes schedule at the same time for the same time the same
+   way with and without --pdes */
+static inline unsigned long long lp_seq()
 {
-    if (msg->data!=NULL) free(msg->data);
-    if (msg!=NULL) free(msg);
+    return (unsigned long long) lp->id << 56 | lp->nscheduled++;
 }
 
-/* get simulation time (in seconds) - for both the sender and the receiver */
+/* schedule an event of the logical process running on this thread */
+static void lp_schedule(Event *e)
+{
+    lp->core->schedule(e, lp->core->time(), lp_seq());
+}
+
+/* the event of a packet arriving at a logical process */
+static Event *lp_packet_event(int to, const struct packet *pkt)
+{
+    if (to==LP_RECEIVER) {
+	EventReceiverFromLowerLayer *e = new EventReceiverFromLowerLayer;
+	memcpy(&e->pkt.data, pkt->data, RDT_PKTSIZE);
+	return e;
+    }
+    EventSenderFromLowerLayer *e = new EventSenderFromLowerLayer;
+    memcpy(&e->pkt.data, pkt->data, RDT_PKTSIZE);
+    return e;
+}
+
+/* send a packet arriving at time to the other logical process */
+static void lp_send(int to, double time, const struct packet *pkt)
+{
+    lp->pkts_passed++;
+    if (!pdes) {
+	Event *e = lp_packet_event(to, pkt);
+	e->sched_time = time;
+	lp_schedule(e);
+	return;
+    }
+
+    struct lp_arrival a;
+    a.time = time;
+    a.created = lp->core->time();
+    a.seq = lp_seq();
+    memcpy(&a.pkt.data, pkt->data, RDT_PKTSIZE);
+    pdes_pending.fetch_add(1, std::memory_order_relaxed);
+    lps[to].channel.push(a);
+}
+
+/* get simulation time (in seconds) - for both the sender and the receiver,
+   that of the logical process calling */
 double GetSimulationTime()
 {
-    return sim_core.time();
+    return lp->core->time();
 }
 
-/* start the sender timer with a specified timeout (in seconds).
-   the timer is cancelled with Sender_StopTimer() is called or a new 
-   Sender_StartTimer() is called before the current timer expires.
-   Sender_Timeout() will be called when the timer expires. */
-void Sender_StartTimer(double timeout)
+/* start the sender timer of a connection with a specified timeout (in
+   seconds).  the timer is cancelled with Sender_StopConnTimer() is called
+   or a new Sender_StartConnTimer() is called before the current timer
+   expires.  Sender_ConnTimeout() will be called when the timer expires. */
+void Sender_StartConnTimer(int conn, double timeout)
 {
     if (tracing_level>=1)
 	fprintf(stdout, "Time %.2fs (Sender): the timer is started (expires at %.2fs).\n",
-		sim_core.time(), sim_core.time() + timeout);
+		lp->core->time(), lp->core->time() + timeout);
 
-    if (sender_timer!=NULL) {
-	sim_core.cancel(sender_timer);
-	delete sender_timer;
-	sender_timer = NULL;
+    Event *&timer = conns[conn].sender_timer;
+    if (timer!=NULL) {
+	lp->core->cancel(timer);
+	delete timer;
+	timer = NULL;
     }
 
     EventSenderTimeout *e = new EventSenderTimeout;
-    e->sched_time = sim_core.time() + timeout;
-    sim_core.schedule(e);
+    e->conn = conn;
+    e->sched_time = lp->core->time() + timeout;
+    lp_schedule(e);
 
-    sender_timer = e;
+    timer = e;
 }
 
-/* stop the sender timer */
-void Sender_StopTimer()
+/* stop the sender timer of a connection */
+void Sender_StopConnTimer(int conn)
 {
     if (tracing_level>=1)
 	fprintf(stdout, "Time %.2fs (Sender): the timer is stopped.\n", 
-		sim_core.time());
+		lp->core->time());
 
-    if (sender_timer!=NULL) {
-	sim_core.cancel(sender_timer);
-	delete sender_timer;
-	sender_timer = NULL;
+    Event *&timer = conns[conn].sender_timer;
+    if (timer!=NULL) {
+	lp->core->cancel(timer);
+	delete timer;
+	timer = NULL;
     }
 }
 
-/* check whether the sender timer is being set,
+/* check whether the sender timer of a connection is being set,
    return true if the timer is set, return false otherwise */
+bool Sender_isConnTimerSet(int conn)
+{
+    return (conns[conn].sender_timer!=NULL);
+}
+
+/* the sender timer of rdt_sender.h is that of connection 0 */
+void Sender_StartTimer(double timeout)
+{
+    Sender_StartConnTimer(0, timeout);
+}
+
+void Sender_StopTimer()
+{
+    Sender_StopConnTimer(0);
+}
+
 bool Sender_isTimerSet()
 {
-    return (sender_timer!=NULL);
+    return Sender_isConnTimerSet(0);
+}
+
+/* start the receiver timer of a connection, see rdt_receiver_timer.h */
+void Receiver_StartTimer(int conn, double timeout)
+{
+    if (tracing_level>=1)
+	fprintf(stdout, "Time %.2fs (Receiver): the timer is started (expires at %.2fs).\n",
+		lp->core->time(), lp->core->time() + timeout);
+
+    Event *&timer = conns[conn].receiver_timer;
+    if (timer!=NULL) {
+	lp->core->cancel(timer);
+	delete timer;
+	timer = NULL;
+    }
+
+    EventReceiverTimeout *e = new EventReceiverTimeout;
+    e->conn = conn;
+    e->sched_time = lp->core->time() + timeout;
+    lp_schedule(e);
+
+    timer = e;
+}
+
+/* stop the receiver timer of a connection */
+void Receiver_StopTimer(int conn)
+{
+    if (tracing_level>=1)
+	fprintf(stdout, "Time %.2fs (Receiver): the timer is stopped.\n",
+		lp->core->time());
+
+    Event *&timer = conns[conn].receiver_timer;
+    if (timer!=NULL) {
+	lp->core->cancel(timer);
+	delete timer;
+	timer = NULL;
+    }
+}
+
+bool Receiver_isTimerSet(int conn)
+{
+    return (conns[conn].receiver_timer!=NULL);
+}
+
+/* the sender has room for the held message of a connection again,
+   deliver it right away */
+void Sender_Writable(int conn)
+{
+    struct sim_conn *c = &conns[conn];
+    if (c->blocked_arrival==NULL) return;
+
+    Metrics_UpperLayerBlocked(lp->core->time() - c->blocked_since);
+    c->blocked_arrival->sched_time = lp->core->time();
+    lp_schedule(c->blocked_arrival);
+    c->blocked_arrival = NULL;
 }
 
 /* pass a packet to the lower layer at the sender */
 void Sender_ToLowerLayer(struct packet *pkt)
 {
-    /* packet lost at rate "loss_rate" */
-    if (myrandom()<loss_rate) return;
+    /* queued for the bottleneck, unless the queue drops it */
+    double departure;
+    if (!Link_Send(&link_s2r, lp->core->time(), &departure)) return;
 
-    EventReceiverFromLowerLayer *e = new EventReceiverFromLowerLayer;
-    memcpy(&e->pkt.data, pkt->data, RDT_PKTSIZE);
+    /* packet lost as the loss model decides */
+    if (Impair_Lost(&impair_s2r)) return;
+
+    struct packet p;
+    memcpy(&p.data, pkt->data, RDT_PKTSIZE);
 
     /* packet corrupted at rate "corrupt_rate" */
-    if (myrandom()<corrupt_rate) {
+    if (myrandom(RNG_S2R + LINK_CORRUPT)<corrupt_rate) {
 	for (int i=0; i<RDT_PKTSIZE; i++) {
-	    e->pkt.data[i] = e->pkt.data[i] + (char)(myrandom()*20) - 10;
+	    p.data[i] = p.data[i] + (char)(myrandom(RNG_S2R + LINK_NOISE)*20) - 10;
 	}
     }
 
     /* schedule the packet arrival event at the other side */
-    if (myrandom()<outoforder_rate)
-	e->sched_time = sim_core.time() + pkt_latency*2.0*myrandom();
-    else
-	e->sched_time = sim_core.time() + pkt_latency;
-    sim_core.schedule(e);
-
-    tot_pkts_passed ++;
+    double arrival = departure + Impair_Delay(&impair_s2r);
+    lp_send(LP_RECEIVER, arrival, &p);
 }
 
 
 /* pass a packet to the lower layer at the receiver */
 void Receiver_ToLowerLayer(struct packet *pkt)
 {
-    /* packet lost at rate "loss_rate" */
-    if (myrandom()<loss_rate) return;
+    /* queued for the bottleneck, unless the queue drops it */
+    double departure;
+    if (!Link_Send(&link_r2s, lp->core->time(), &departure)) return;
 
-    EventSenderFromLowerLayer *e = new EventSenderFromLowerLayer;
-    memcpy(&e->pkt.data, pkt->data, RDT_PKTSIZE);
+    /* packet lost as the loss model decides */
+    if (Impair_Lost(&impair_r2s)) return;
+
+    struct packet p;
+    memcpy(&p.data, pkt->data, RDT_PKTSIZE);
 
     /* packet corrupted at rate "corrupt_rate" */
-    if (myrandom()<corrupt_rate) {
+    if (myrandom(RNG_R2S + LINK_CORRUPT)<corrupt_rate) {
 	for (int i=0; i<RDT_PKTSIZE; i++) {
-	    e->pkt.data[i] = e->pkt.data[i] + (char)(myrandom()*20) - 10;
+	    p.data[i] = p.data[i] + (char)(myrandom(RNG_R2S + LINK_NOISE)*20) - 10;
 	}
     }
 
     /* schedule the packet arrival event at the other side */
-    if (myrandom()<outoforder_rate)
-	e->sched_time = sim_core.time() + pkt_latency*2.0*myrandom();
-    else
-	e->sched_time = sim_core.time() + pkt_latency;	
-    sim_core.schedule(e);
-
-    tot_pkts_passed ++;
+    double arrival = departure + Impair_Delay(&impair_r2s);
+    lp_send(LP_SENDER, arrival, &p);
 }
 
-/* deliver a message to the upper layer at the receiver 
+/* deliver a message of a connection to the upper layer at the receiver 
    NOTE: change the message verification in this function if you changed 
          generate_msg() for testing. */
-void Receiver_ToUpperLayer(struct message *msg)
+void Receiver_ConnToUpperLayer(int conn, struct message *msg)
 {
-    static char cnt = 0;
+    char &cnt = conns[conn].delivered_cnt;
 
     for (int i=0; i<msg->size; i++) {
 	/* message verification */
@@ -345,6 +575,13 @@ void Receiver_ToUpperLayer(struct message *msg)
     }
 
     tot_chars_delivered += msg->size;
+    Metrics_MessageDelivered(conn, msg->size);
+}
+
+/* deliver a message of connection 0 */
+void Receiver_ToUpperLayer(struct message *msg)
+{
+    Receiver_ConnToUpperLayer(0, msg);
 }
 
 
@@ -352,71 +589,383 @@ void Receiver_ToUpperLayer(struct message *msg)
   |  main simulation control routine
   []------------------------------------------------------------------------[]*/
 
-int main(int argc, char *argv[])
+/* read the trace the trace model replays, only once for all the calls
+   with the same file.  return 0 on success, -1 otherwise */
+static int load_impair_trace(const char *path)
 {
-    if (argc!=8) {
-	fprintf(stderr, "usage: %s <sim_time> <mean_msg_arrivalint> <mean_msg_size> "
-		"<outoforder_rate> <loss_rate> <corrupt_rate> <tracing_level>\n", 
-		argv[0]);
-	exit(-1);
-    }
+    if (path==NULL) return -1;
+    if (impair_trace_path!=NULL && strcmp(path, impair_trace_path)==0) return 0;
+    if (Impair_Load(path, impair_trace)<0) return -1;
+    impair_trace_path = path;
+    return 0;
+}
 
-    sim_time = atof(argv[1]);
-    if (sim_time<=0) {
-	fprintf(stderr, "invalid <sim_time>\n");
-	exit(-1);
-    }
-    msg_arrivalint = atof(argv[2]);
-    if (msg_arrivalint<=0) {
-	fprintf(stderr, "invalid <msg_arrivalint>\n");
-	exit(-1);
+/* the least time a packet takes to cross the link: its serialization time,
+   plus the latency unless reordering may shorten it, or plus the least
+   delay of a replayed trace */
+double Sim_Lookahead(const struct sim_params *p)
+{
+    double t = p->bandwidth>0 ? RDT_PKTSIZE / p->bandwidth : 0;
+    if (p->loss_model==LOSS_TRACE) {
+	if (load_impair_trace(p->impair_trace)==0 && Impair_MinDelay(impair_trace)>0)
+	    t += Impair_MinDelay(impair_trace);
     }
-    msg_size = atoi(argv[3]);
-    if (msg_size<=0) {
-	fprintf(stderr, "invalid <msg_size>\n");
-	exit(-1);
+    else if (p->outoforder_rate==0)
+	t += p->latency;
+    return t;
+}
+
+/* check the parameters, return an error message or NULL if they are valid */
+const char *Sim_CheckParams(const struct sim_params *p)
+{
+    if (p->sim_time<=0) return "invalid <sim_time>";
+    if (p->msg_arrivalint<=0) return "invalid <msg_arrivalint>";
+    if (p->msg_size<=0) return "invalid <msg_size>";
+    if (p->latency<=0) return "invalid <latency>";
+    if (p->bandwidth<0) return "invalid <bandwidth>";
+    if (p->queue<1) return "invalid <queue>";
+    if (p->aqm<0 || p->aqm>=AQM_NUM) return "invalid <aqm>";
+    if (p->outoforder_rate<0 || p->outoforder_rate>1)
+	return "invalid <outoforder_rate>";
+    if (p->loss_rate<0 || p->loss_rate>1) return "invalid <loss_rate>";
+    if (p->corrupt_rate<0 || p->corrupt_rate>1) return "invalid <corrupt_rate>";
+    if (p->loss_model<0 || p->loss_model>=LOSS_NUM) return "invalid <loss_model>";
+    if (p->ge_p<0 || p->ge_p>1 || p->ge_r<0 || p->ge_r>1)
+	return "invalid <ge_p> or <ge_r>";
+    if (p->ge_good_loss<0 || p->ge_good_loss>1 || p->ge_bad_loss<0 || p->ge_bad_loss>1)
+	return "invalid <ge_good_loss> or <ge_bad_loss>";
+    if (p->reorder_corr<0 || p->reorder_corr>1) return "invalid <reorder_corr>";
+    if (p->loss_model==LOSS_TRACE && load_impair_trace(p->impair_trace)<0)
+	return "invalid <impair_trace>, cannot read an impairment trace from it";
+    if (p->tracing_level<0 || p->tracing_level>2) return "invalid <tracing_level>";
+    if (p->sched_kind<0 || p->sched_kind>=SCHED_NUM) return "invalid <scheduler>";
+    if (p->rdt.protocol<0 || p->rdt.protocol>=PROTO_NUM) return "invalid <protocol>";
+    if (p->rdt.rto<0 || p->rdt.rto>=RTO_NUM) return "invalid <rto>";
+    if (p->rdt.cc<0 || p->rdt.cc>=CC_NUM) return "invalid <cc>";
+    if (p->rdt.header<HDR_V1 || p->rdt.header>=HDR_NUM) return "invalid <header>";
+    if (p->rdt.checksum<0 || p->rdt.checksum>=CSUM_NUM) return "invalid <checksum>";
+    /* the largest message must fit in the send buffer */
+    const struct hdr_format *f = Header_Format(p->rdt.header, p->rdt.checksum);
+    int max_payload = f->max_payload;
+    if (p->rdt.fec!=FEC_OFF) max_payload = Header_SymbolSize(f) - 1;
+    if (p->rdt.coalesce>0) max_payload--;       /* the record header */
+    if (p->rdt.send_buffer<(2*p->msg_size + max_payload - 1)/max_payload)
+	return "invalid <send_buffer>, too small for the largest message";
+    if (p->rdt.ack_every<1) return "invalid <ack_every>";
+    if (p->rdt.ack_delay<=0) return "invalid <ack_delay>";
+    if (p->rdt.coalesce<0) return "invalid <coalesce>";
+    if (p->rdt.coalesce_delay<=0) return "invalid <coalesce_delay>";
+    if (p->rdt.fast_rtx<0 || p->rdt.fast_rtx>=FRTX_NUM) return "invalid <fast_retransmit>";
+    if (p->rdt.fec<0 || p->rdt.fec>=FEC_NUM) return "invalid <fec>";
+    if (p->rdt.fec_k<1 || p->rdt.fec_m<1 || p->rdt.fec_k + p->rdt.fec_m>FEC_MAX_BLOCK)
+	return "invalid <fec_k> or <fec_m>";
+    if (p->rdt.connections<1 || p->rdt.connections>CONN_MAX) return "invalid <connections>";
+    if (p->rdt.connections>1 && p->rdt.header<HDR_V3)
+	return "invalid <connections>, more than one needs header v3";
+    if (p->pdes && p->loss_model==LOSS_TRACE && Sim_Lookahead(p)<=0)
+	return "invalid <pdes>, the impairment trace has zero-delay packets";
+    if (p->pdes && Sim_Lookahead(p)<=0)
+	return "invalid <pdes>, reordering leaves no lookahead without a <bandwidth>";
+    if (p->pdes && (p->tracing_level>0 || RDT_TRACE_LEVEL>0))
+	return "invalid <pdes>, tracing needs the sequential run";
+    return NULL;
+}
+
+/* dump the metrics of a finished run as JSON */
+static void write_json(const struct sim_params *p, const struct sim_result *r)
+{
+    FILE *f = strcmp(p->json_file, "-")==0 ? stdout : fopen(p->json_file, "w");
+    if (f==NULL) {
+	fprintf(stderr, "cannot open %s for writing\n", p->json_file);
+	return;
     }
-    outoforder_rate = atof(argv[4]);
-    if (outoforder_rate<0 || outoforder_rate>1) {
-	fprintf(stderr, "invalid <outoforder_rate>\n");
-	exit(-1);
+
+    char params[1024];
+    snprintf(params, sizeof(params), "{\"sim_time\": %g, \"msg_arrivalint\": %g, "
+	     "\"msg_size\": %d, \"latency\": %g, \"bandwidth\": %g, "
+	     "\"queue\": %d, \"aqm\": \"%s\", \"outoforder_rate\": %g, "
+	     "\"loss_rate\": %g, \"corrupt_rate\": %g, \"loss_model\": \"%s\", "
+	     "\"ge_p\": %g, \"ge_r\": %g, \"ge_good_loss\": %g, \"ge_bad_loss\": %g, "
+	     "\"reorder_corr\": %g, \"sched\": \"%s\", "
+	     "\"protocol\": \"%s\", \"rto\": \"%s\", \"cc\": \"%s\", "
+	     "\"header\": \"%s\", \"checksum\": \"%s\", \"send_buffer\": %d, "
+	     "\"sack\": %s, \"ack_every\": %d, \"ack_delay\": %g, "
+	     "\"coalesce\": %d, \"coalesce_delay\": %g, \"fast_retransmit\": \"%s\", "
+	     "\"fec\": \"%s\", \"fec_k\": %d, \"fec_m\": %d, \"connections\": %d, "
+	     "\"pdes\": %s, \"seed\": %lu}",
+	     p->sim_time, p->msg_arrivalint, p->msg_size, p->latency,
+	     p->bandwidth, p->queue, Aqm_Name(p->aqm), p->outoforder_rate, p->loss_rate, p->corrupt_rate,
+	     Loss_Name(p->loss_model), p->ge_p, p->ge_r, p->ge_good_loss, p->ge_bad_loss,
+	     p->reorder_corr, EventQueue_Name(p->sched_kind), Protocol_Name(p->rdt.protocol),
+	     Rto_Name(p->rdt.rto), CC_Name(p->rdt.cc), Header_Name(p->rdt.header),
+	     Checksum_Name(p->rdt.checksum), p->rdt.send_buffer,
+	     p->rdt.sack ? "true" : "false", p->rdt.ack_every, p->rdt.ack_delay,
+	     p->rdt.coalesce, p->rdt.coalesce_delay, FastRtx_Name(p->rdt.fast_rtx),
+	     Fec_Name(p->rdt.fec), p->rdt.fec_k, p->rdt.fec_m, p->rdt.connections,
+	     p->pdes ? "true" : "false", p->seed);
+
+    struct metrics_totals t;
+    t.end_time = r->end_time;
+    t.chars_sent = r->chars_sent;
+    t.chars_delivered = r->chars_delivered;
+    t.pkts_passed = r->pkts_passed;
+    t.events = r->events;
+    t.wall_time = r->wall_time;
+    t.verified = r->verified;
+    t.connections = p->rdt.connections;
+    t.memory_per_conn = r->memory_per_conn;
+    t.s2r = &r->s2r;
+    t.r2s = &r->r2s;
+    Metrics_WriteJSON(f, params, &t);
+
+    if (f!=stdout) fclose(f);
+    else fflush(f);
+}
+
+/* run an event of the logical process on this thread */
+static void handle_event(Event *e)
+{
+    switch (e->event_type) {
+    case EVENT_SENDER_FROMUPPERLAYER:
+	{
+	    if (tracing_level>=1) {
+		fprintf(stdout, "Time %.2fs (Sender): the upper layer instructs rdt layer to send out a message.\n", lp->core->time());
+	    }
+
+	    EventSenderFromUpperLayer *real_e = (EventSenderFromUpperLayer*) e;
+	    struct sim_conn *c = &conns[real_e->conn];
+
+	    struct message *msg = c->blocked_msg!=NULL ? c->blocked_msg
+							: generate_msg(real_e->conn);
+	    c->blocked_msg = NULL;
+	    if (Sender_WouldBlock(real_e->conn, msg->size)) {
+		/* hold the message and stop generating until the sender
+		   calls Sender_Writable() */
+		c->blocked_msg = msg;
+		c->blocked_arrival = real_e;
+		c->blocked_since = lp->core->time();
+		break;
+	    }
+	    /* the sender frees it once it has been packetized */
+	    Sender_TakeMessage(real_e->conn, msg);
+
+	    /* schedule the recurring event */
+	    if (lp->core->time() < sim_time) {
+		real_e->sched_time = 
+		    lp->core->time() + msg_arrivalint*2.0*myrandom(RNG_MSG_ARRIVAL);
+		lp_schedule(real_e);
+	    }
+	    else
+		delete real_e;
+	}
+	break;
+
+    case EVENT_SENDER_FROMLOWERLAYER:
+	{
+	    if (tracing_level>=1) {
+		fprintf(stdout, "Time %.2fs (Sender): the lower layer informs the rdt layer that a packet is received from the link.\n", lp->core->time());
+	    }
+
+	    EventSenderFromLowerLayer *real_e = (EventSenderFromLowerLayer*) e;
+
+	    Sender_FromLowerLayer(&real_e->pkt);
+
+	    delete real_e;
+	}
+	break;
+
+    case EVENT_SENDER_TIMEOUT:
+	{
+	    if (tracing_level>=1) {
+		fprintf(stdout, "Time %.2fs (Sender): the timer expires.\n", lp->core->time());
+	    }
+
+	    EventSenderTimeout *real_e = (EventSenderTimeout*) e;
+	    int conn = real_e->conn;
+	    delete real_e;
+	    conns[conn].sender_timer = NULL;
+
+	    Sender_ConnTimeout(conn);
+	}
+	break;
+
+    case EVENT_RECEIVER_FROMLOWERLAYER:
+	{
+	    if (tracing_level>=1) {
+		fprintf(stdout, "Time %.2fs (Receiver): the lower layer informs the rdt layer that a packet is received from the link.\n", lp->core->time());
+	    }
+
+	    EventReceiverFromLowerLayer *real_e = (EventReceiverFromLowerLayer*) e;
+
+	    Receiver_FromLowerLayer(&real_e->pkt);
+
+	    delete real_e;
+	}
+	break;
+
+    case EVENT_RECEIVER_TIMEOUT:
+	{
+	    if (tracing_level>=1) {
+		fprintf(stdout, "Time %.2fs (Receiver): the timer expires.\n", lp->core->time());
+	    }
+
+	    EventReceiverTimeout *real_e = (EventReceiverTimeout*) e;
+	    int conn = real_e->conn;
+	    delete real_e;
+	    conns[conn].receiver_timer = NULL;
+
+	    Receiver_Timeout(conn);
+	}
+	break;
+
+    default:
+	fprintf(stderr, "undefined event %d\n", e->event_type);
+	break;
     }
-    loss_rate = atof(argv[5]);
-    if (loss_rate<0 || loss_rate>1) {
-	fprintf(stderr, "invalid <loss_rate>\n");
-	exit(-1);
+}
+
+/* the logical process an event belongs to */
+static inline int event_lp(const Event *e)
+{
+    return e->event_type>=EVENT_RECEIVER_FROMLOWERLAYER ? LP_RECEIVER : LP_SENDER;
+}
+
+/* run a logical process on this thread until the simulation is over, see
+   rdt_pdes.h */
+static void lp_run(struct sim_lp *l)
+{
+    lp = l;
+    struct sim_lp *peer = &lps[LP_NUM - 1 - l->id];
+    bool busy = true;
+
+    for (;;) {
+	/* the packets the peer sent before making its promise */
+	double bound = peer->promise.load(std::memory_order_acquire);
+	long long received = 0;
+	struct lp_arrival *a;
+	while ((a = l->channel.front())!=NULL) {
+	    Event *e = lp_packet_event(l->id, &a->pkt);
+	    e->sched_time = a->time;
+	    l->core->schedule(e, a->created, a->seq);
+	    l->channel.pop();
+	    received++;
+	}
+	if (received>0) {
+	    if (!busy) {
+		pdes_pending.fetch_add(1);
+		busy = true;
+	    }
+	    pdes_pending.fetch_sub(received);
+	}
+
+	/* the events no packet from the peer can come before */
+	double start = thread_time();
+	unsigned long long events = l->events;
+	Event *e;
+	while ((e = l->core->peek())!=NULL && e->sched_time<bound) {
+	    l->core->next_event();
+	    l->events++;
+	    handle_event(e);
+	}
+	l->busy += thread_time() - start;
+	l->rounds++;
+
+	e = l->core->peek();
+	double next = e!=NULL ? std::min(e->sched_time, bound) : bound;
+	l->promise.store(next + lookahead, std::memory_order_release);
+
+	if (e==NULL && l->channel.front()==NULL) {
+	    if (busy) {
+		busy = false;
+		if (pdes_pending.fetch_sub(1)==1) break;
+	    }
+	    else if (pdes_pending.load()==0)
+		break;
+	}
+	if (l->events==events && received==0)
+	    std::this_thread::yield();
     }
-    corrupt_rate = atof(argv[6]);
-    if (corrupt_rate<0 || corrupt_rate>1) {
-	fprintf(stderr, "invalid <corrupt_rate>\n");
-	exit(-1);
+    l->pool = event_pool_stats;
+}
+
+/* print the queue statistics of a link direction */
+static void print_link(const char *dir, const struct link_stats *s, double tx_time,
+		       double end)
+{
+    long long drops = s->tail_drops + s->early_drops;
+    long long accepted = s->offered - drops;
+    fprintf(stdout, "## link %s: %lld of %lld packets dropped by the queue "
+	    "(%lld early), mean queue %.2f (max %d), mean queueing delay %.4fs, "
+	    "utilization %.1f%%\n",
+	    dir, drops, s->offered, s->early_drops, end>0 ? s->sojourn / end : 0.0,
+	    s->max_queue, accepted>0 ? s->sojourn / accepted - tx_time : 0.0,
+	    end>0 ? 100.0 * s->busy / end : 0.0);
+}
+
+/* print the impairment statistics of a link direction */
+static void print_impair(const char *dir, const struct impair_stats *s)
+{
+    fprintf(stdout, "## %s: %lld of %lld packets lost (%.2f%%) in %lld bursts, "
+	    "mean burst %.2f packets\n",
+	    dir, s->lost, s->packets, s->packets>0 ? 100.0 * s->lost / s->packets : 0.0,
+	    s->bursts, s->bursts>0 ? (double) s->lost / s->bursts : 0.0);
+}
+
+/* run one complete simulation */
+void Sim_Run(const struct sim_params *p, struct sim_result *r)
+{
+    sim_time = p->sim_time;
+    msg_arrivalint = p->msg_arrivalint;
+    msg_size = p->msg_size;
+    pkt_latency = p->latency;
+    outoforder_rate = p->outoforder_rate;
+    loss_rate = p->loss_rate;
+    corrupt_rate = p->corrupt_rate;
+    tracing_level = p->tracing_level;
+    sched_kind = p->sched_kind;
+    sim_core.set_backend(sched_kind);
+    rdt_config = p->rdt;
+    pdes = p->pdes;
+    lookahead = Sim_Lookahead(p);
+    for (int i=0; i<LP_NUM; i++) {
+	lps[i].id = i;
+	lps[i].core = &sim_core;
+	lps[i].promise.store(lookahead);
     }
-    tracing_level = atoi(argv[7]);
-    if (tracing_level<0 || tracing_level>2) {
-	fprintf(stderr, "invalid <tracing_level>\n");
-	exit(-1);
+    if (pdes) {
+	receiver_core.set_backend(sched_kind);
+	lps[LP_RECEIVER].core = &receiver_core;
+	pdes_pending.store(LP_NUM);
     }
-    
-    fprintf(stdout, "## Reliable data transfer simulation with:\n"
-	    "\tsimulation time is %.3f seconds\n"
-	    "\taverage message arrival interval is %.3f seconds\n"
-	    "\taverage message size is %d bytes\n"
-	    "\taverage out-of-order delivery rate is %.2f%%\n"
-	    "\taverage loss rate is %.2f%%\n"
-	    "\taverage corrupt rate is %.2f%%\n"
-	    "\ttracing level is %d\n"
-	    "Please review these inputs and press <enter> to proceed.\n",
-	    sim_time, msg_arrivalint, msg_size, outoforder_rate*100.0, 
-	    loss_rate*100.0, corrupt_rate*100.0, tracing_level);
-    fgetc(stdin);
-
-    /* initialize the random number generator */
-    srand(getpid()+getppid());
+    Link_Init(&link_s2r, p->bandwidth, p->queue, p->aqm, &rng[RNG_RED_S2R]);
+    Link_Init(&link_r2s, p->bandwidth, p->queue, p->aqm, &rng[RNG_RED_R2S]);
+    struct impair_params ip;
+    ip.model = p->loss_model;
+    ip.loss_rate = p->loss_rate;
+    ip.ge_p = p->ge_p;
+    ip.ge_r = p->ge_r;
+    ip.ge_good_loss = p->ge_good_loss;
+    ip.ge_bad_loss = p->ge_bad_loss;
+    ip.outoforder_rate = p->outoforder_rate;
+    ip.reorder_corr = p->reorder_corr;
+    ip.latency = p->latency;
+    if (ip.model==LOSS_TRACE) load_impair_trace(p->impair_trace);
+    bool record = p->impair_record!=NULL;
+    Impair_Init(&impair_s2r, &ip, &impair_trace[0], &rng[RNG_S2R + LINK_LOSS],
+		&rng[RNG_GE_S2R], &rng[RNG_S2R + LINK_REORDER],
+		&rng[RNG_S2R + LINK_DELAY], record ? &impair_log[0] : NULL);
+    Impair_Init(&impair_r2s, &ip, &impair_trace[1], &rng[RNG_R2S + LINK_LOSS],
+		&rng[RNG_GE_R2S], &rng[RNG_R2S + LINK_REORDER],
+		&rng[RNG_R2S + LINK_DELAY], record ? &impair_log[1] : NULL);
+
+    /* initialize the random number streams */
+    for (int i=0; i<RNG_NUM; i++)
+	rng_seed(&rng[i], p->seed, i);
 
     /* test the random number generator */
     double randtest_sum = 0.0;
     for (int i=0; i<1000; i++)
-	randtest_sum += myrandom();
+	randtest_sum += myrandom(RNG_RANDTEST);
     double randtest_avg = randtest_sum/1000;
     if (randtest_avg<0.25 || randtest_avg>0.75) {
 	fprintf(stderr, 
@@ -427,106 +976,456 @@ int main(int argc, char *argv[])
     }
 
     /* intialize the sender and the receiver */
+    int nconns = rdt_config.connections;
+    struct sim_conn idle = {NULL, NULL, NULL, NULL, 0, 0, 0};
+    conns.assign(nconns, idle);
+    Metrics_Connections(nconns);
+    lp = &lps[LP_SENDER];
     Sender_Init();
+    lp = &lps[LP_RECEIVER];
     Receiver_Init();
-
-    /* scheduling a recurring message arrival event */
-    EventSenderFromUpperLayer *e = new EventSenderFromUpperLayer;
-    e->sched_time = 0;
-    sim_core.schedule(e);
+    lp = &lps[LP_SENDER];
+
+    /* scheduling a recurring message arrival event per connection */
+    for (int i=0; i<nconns; i++) {
+	EventSenderFromUpperLayer *e = new EventSenderFromUpperLayer;
+	e->conn = i;
+	e->sched_time = 0;
+	lp_schedule(e);
+    }
 
     /* main simulation cycle */
-    for (;;) {
-	Event *e = sim_core.next_event();
-	if (e==NULL) break;
-
-	switch (e->event_type) {
-	case EVENT_SENDER_FROMUPPERLAYER:
-	    {
-		if (tracing_level>=1) {
-		    fprintf(stdout, "Time %.2fs (Sender): the upper layer instructs rdt layer to send out a message.\n", sim_core.time());
-		}
-
-		EventSenderFromUpperLayer *real_e = (EventSenderFromUpperLayer*) e;
-
-		struct message *msg = generate_msg();
-		Sender_FromUpperLayer(msg);
-		free_msg(msg);
-
-		/* schedule the recurring event */
-		if (sim_core.time() < sim_time) {
-		    real_e->sched_time = 
-			sim_core.time() + msg_arrivalint*2.0*myrandom();
-		    sim_core.schedule(real_e);
-		}
-		else
-		    delete real_e;
-	    }
-	    break;
-
-	case EVENT_SENDER_FROMLOWERLAYER:
-	    {
-		if (tracing_level>=1) {
-		    fprintf(stdout, "Time %.2fs (Sender): the lower layer informs the rdt layer that a packet is received from the link.\n", sim_core.time());
-		}
+    double wall_start = wall_time();
+    if (!pdes) {
+	for (;;) {
+	    Event *e = sim_core.next_event();
+	    if (e==NULL) break;
+	    lp = &lps[event_lp(e)];
+	    lp->events++;
+	    handle_event(e);
+	}
+	lps[LP_SENDER].pool = event_pool_stats;
+    }
+    else {
+	std::thread receiver(lp_run, &lps[LP_RECEIVER]);
+	lp_run(&lps[LP_SENDER]);
+	receiver.join();
+    }
+    lp = &lps[LP_SENDER];
+
+    double wall_elapsed = wall_time() - wall_start;
+    double end_time = std::max(sim_core.time(), lps[LP_RECEIVER].core->time());
+    struct event_pool_stats pool = {0, 0};
+    for (int i=0; i<LP_NUM; i++) {
+	tot_events += lps[i].events;
+	tot_pkts_passed += lps[i].pkts_passed;
+	pool.allocs += lps[i].pool.allocs;
+	pool.slabs += lps[i].pool.slabs;
+    }
+    /* the state of a connection as allocated, unlike the resident memory
+       of the process the same for every run */
+    double memory_per_conn = (double) (Sender_ConnMemory() + Receiver_ConnMemory() +
+				       nconns * sizeof(struct sim_conn)) / nconns;
 
-		EventSenderFromLowerLayer *real_e = (EventSenderFromLowerLayer*) e;
+    /* finalize the sender and the receiver */
+    Sender_Final();
+    Receiver_Final();
 
-		Sender_FromLowerLayer(&real_e->pkt);
+    fprintf(stdout, "\n");
+    fprintf(stdout, "## Simulation completed at time %.2fs with\n" 
+	    "\t%lld characters sent\n" 
+	    "\t%lld characters delivered\n"
+	    "\t%lld packets passed between the sender and the receiver\n", 
+	    end_time, tot_chars_sent, tot_chars_delivered, tot_pkts_passed);
+    fprintf(stdout, "## Simulator processed %llu events in %.3fs (%.0f events/sec), "
+	    "%llu event allocations served by %llu slab allocations\n",
+	    tot_events, wall_elapsed, wall_elapsed>0 ? tot_events/wall_elapsed : 0.0,
+	    pool.allocs, pool.slabs);
+    if (pdes) {
+	/* with one core per process the run takes at least as long as the
+	   busier one */
+	double busy = std::max(lps[LP_SENDER].busy, lps[LP_RECEIVER].busy);
+	fprintf(stdout, "## PDES: %d logical processes on %u cores, lookahead %.4fs, "
+		"%llu/%llu rounds, busy %.3fs/%.3fs, speedup bound %.2f\n",
+		LP_NUM, std::thread::hardware_concurrency(), lookahead,
+		lps[LP_SENDER].rounds, lps[LP_RECEIVER].rounds,
+		lps[LP_SENDER].busy, lps[LP_RECEIVER].busy,
+		busy>0 ? (lps[LP_SENDER].busy + lps[LP_RECEIVER].busy) / busy : 0.0);
+    }
 
-		delete real_e;
-	    }
-	    break;
+    struct metrics_retx retx;
+    Metrics_Retransmissions(&retx);
+    fprintf(stdout, "## %lld retransmissions after %lld timeouts, %lld spurious (%.1f%%), "
+	    "mean recovery time %.3fs\n",
+	    retx.retransmissions, retx.timeouts, retx.spurious,
+	    retx.retransmissions>0 ? 100.0*retx.spurious/retx.retransmissions : 0.0,
+	    retx.recovery_mean);
+    if (retx.fast_retransmits>0)
+	fprintf(stdout, "## %lld fast retransmits after %d duplicate acks\n",
+		retx.fast_retransmits, DUPACK_THRESHOLD);
+
+    if (nconns>1)
+	fprintf(stdout, "## %d connections, their state takes %.1f KB per connection\n",
+		nconns, memory_per_conn / 1024);
+
+    if (p->loss_model!=LOSS_BERNOULLI) {
+	print_impair("sender to receiver", &impair_s2r.stats);
+	print_impair("receiver to sender", &impair_r2s.stats);
+    }
 
-	case EVENT_SENDER_TIMEOUT:
-	    {
-		if (tracing_level>=1) {
-		    fprintf(stdout, "Time %.2fs (Sender): the timer expires.\n", sim_core.time());
-		}
+    if (p->bandwidth>0) {
+	print_link("sender to receiver", &link_s2r.stats, link_s2r.tx_time, end_time);
+	print_link("receiver to sender", &link_r2s.stats, link_r2s.tx_time, end_time);
+    }
 
-		EventSenderTimeout *real_e = (EventSenderTimeout*) e;
-		delete real_e;
-		sender_timer = NULL;
+    struct metrics_sendbuf sb;
+    Metrics_SendBufferUsage(&sb);
+    fprintf(stdout, "## send buffer high-water mark %d of %d packets (%lld bytes), "
+	    "upper layer held back %lld times for %.3fs\n",
+	    sb.high_water, sb.capacity, sb.high_water_bytes, sb.blocked, sb.blocked_time);
 
-		Sender_Timeout();
-	    }
-	    break;
+    if (message_verfication_passed && (tot_chars_sent==tot_chars_delivered))
+	fprintf(stdout, "## Congratulations! This session is error-free, loss-free, and in order.\n");
+    else
+	fprintf(stdout, "## Something is wrong! This session is NOT error-free, loss-free, and in order.\n");
 
-	case EVENT_RECEIVER_FROMLOWERLAYER:
-	    {
-		if (tracing_level>=1) {
-		    fprintf(stdout, "Time %.2fs (Receiver): the lower layer informs the rdt layer that a packet is received from the link.\n", sim_core.time());
-		}
+    r->end_time = end_time;
+    r->chars_sent = tot_chars_sent;
+    r->chars_delivered = tot_chars_delivered;
+    r->pkts_passed = tot_pkts_passed;
+    r->events = tot_events;
+    r->wall_time = wall_elapsed;
+    r->verified = message_verfication_passed && (tot_chars_sent==tot_chars_delivered);
+    r->retransmissions = retx.retransmissions;
+    r->spurious = retx.spurious;
+    r->recovery_mean = retx.recovery_mean;
+    r->memory_per_conn = memory_per_conn;
+    r->s2r = link_s2r.stats;
+    r->r2s = link_r2s.stats;
+    Link_Free(&link_s2r);
+    Link_Free(&link_r2s);
+
+    if (p->json_file!=NULL)
+	write_json(p, r);
+    if (RDT_TRACE_LEVEL>0 && p->trace_file!=NULL && Trace_Dump(p->trace_file)<0)
+	fprintf(stderr, "cannot write trace file %s\n", p->trace_file);
+    if (record && Impair_Save(p->impair_record, impair_log)<0)
+	fprintf(stderr, "cannot write impairment trace %s\n", p->impair_record);
+}
 
-		EventReceiverFromLowerLayer *real_e = (EventReceiverFromLowerLayer*) e;
-		
-		Receiver_FromLowerLayer(&real_e->pkt);
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s <sim_time> <mean_msg_arrivalint> <mean_msg_size> "
+	    "<outoforder_rate> <loss_rate> <corrupt_rate> <tracing_level> "
+	    "[list|heap2|heap4|calendar]\n"
+	    "   or: %s [options]\n"
+	    "\t--sim-time <sec>          simulation time (default 1000)\n"
+	    "\t--arrival <sec>           mean message arrival interval (default 0.1)\n"
+	    "\t--msg-size <bytes>        mean message size (default 100)\n"
+	    "\t--latency <sec>           one-way propagation delay (default 0.1)\n"
+	    "\t--bandwidth <bytes/sec>   link bandwidth, packets queue for the link and\n"
+	    "\t                          take 128 bytes / bandwidth to send (default 0,\n"
+	    "\t                          no limit and no queue)\n"
+	    "\t--queue <packets>         link queue capacity (default 64)\n"
+	    "\t--aqm <name>              link queue discipline: droptail (the default)\n"
+	    "\t                          or red (random early detection)\n"
+	    "\t--outoforder <rate>       out-of-order delivery rate (default 0.15)\n"
+	    "\t--loss <rate>             loss rate (default 0.15)\n"
+	    "\t--corrupt <rate>          corrupt rate (default 0.15)\n"
+	    "\t--loss-model <name>       bernoulli (independent losses at the loss rate,\n"
+	    "\t                          the default), ge (gilbert-elliott burst losses)\n"
+	    "\t                          or trace (replay of an --impair-trace)\n"
+	    "\t--ge-p <prob>             ge: good to bad state, per packet (default 0.01)\n"
+	    "\t--ge-r <prob>             ge: bad to good state, per packet (default 0.25)\n"
+	    "\t--ge-good-loss <rate>     ge: loss rate in the good state (default 0)\n"
+	    "\t--ge-bad-loss <rate>      ge: loss rate in the bad state (default 1)\n"
+	    "\t--reorder-corr <c>        correlation of consecutive reordering decisions\n"
+	    "\t                          (default 0, independent)\n"
+	    "\t--impair-trace <file>     loss and delay trace the trace model replays\n"
+	    "\t--record-impair <file>    record the run's losses and delays as a trace\n"
+	    "\t--trace <level>           tracing level 0-2 (default 0)\n"
+	    "\t--sched <name>            list, heap2, heap4 or calendar (default heap4)\n"
+	    "\t--protocol <name>         gbn (go back n) or sr (selective repeat)\n"
+	    "\t--rto <name>              retransmission timeout, fixed (0.3s) or adaptive\n"
+	    "\t                          (estimated from round-trip times, the default)\n"
+	    "\t--cc <name>               congestion control: fixed (10 packets, the\n"
+	    "\t                          default), reno (slow start and AIMD) or vegas\n"
+	    "\t--header <version>        packet header: v1 (7-bit sequence numbers, the\n"
+	    "\t                          default), v2 (16-bit sequence numbers) or v3\n"
+	    "\t                          (v2 with a connection ID)\n"
+	    "\t--checksum <name>         packet checksum: crc16 (the default) or crc32c\n"
+	    "\t--send-buffer <packets>   sender buffer capacity, a full buffer holds\n"
+	    "\t                          back the upper layer (default 4096)\n"
+	    "\t--sack                    acks carry SACK blocks, timeouts resend only\n"
+	    "\t                          the packets the receiver is missing\n"
+	    "\t--delayed-ack <n>         ack every n in-order packets (default 1, no\n"
+	    "\t                          delay); gaps are acked right away\n"
+	    "\t--ack-delay <sec>         longest delay of a delayed ack (default 0.05)\n"
+	    "\t--coalesce <bytes>        pack small messages into shared packets, sent\n"
+	    "\t                          once this many bytes wait (default 0, off)\n"
+	    "\t--coalesce-delay <sec>    longest wait of a packet that is not full\n"
+	    "\t                          (default 0.05)\n"
+	    "\t--fast-retransmit <name>  resend after 3 duplicate acks: off (timeouts\n"
+	    "\t                          only, the default), retransmit, or recovery\n"
+	    "\t                          (fast recovery as well)\n"
+	    "\t--fec <name>              forward error correction: off (the default),\n"
+	    "\t                          xor (one parity packet per block) or rs\n"
+	    "\t                          (Reed-Solomon, fec-m parity packets)\n"
+	    "\t--fec-k <n>               data packets per FEC block (default 4)\n"
+	    "\t--fec-m <n>               parity packets per block for rs (default 2)\n"
+	    "\t--connections <n>         connections sharing the link, each with its own\n"
+	    "\t                          message stream (default 1, more need header v3)\n"
+	    "\t--pdes                    run the sender and the receiver side on two\n"
+	    "\t                          threads (conservative parallel simulation, needs\n"
+	    "\t                          --outoforder 0 or a --bandwidth for a lookahead)\n"
+	    "\t--seed <n>                random seed (default derived from the pid)\n"
+	    "\t--batch                   don't wait for <enter> before starting\n"
+	    "\t--json <file>             write the run's metrics as JSON (- for stdout)\n"
+	    "\t--trace-file <file>       binary trace output of a make TRACE=n build\n"
+	    "\t                          (default rdt_trace.bin, decode with rdt_tracedump)\n"
+	    "\t--sweep <spec>            run a parameter sweep, spec is a comma separated\n"
+	    "\t                          list of name=lo:hi:step or name=v1/v2/...\n"
+	    "\t                          over outoforder, loss, corrupt, msg-size, arrival,\n"
+	    "\t                          latency, bandwidth, queue, connections\n"
+	    "\t--replicas <n>            runs per sweep point, seeds seed..seed+n-1 (default 5)\n"
+	    "\t--jobs <n>                parallel runs (default: number of cores)\n",
+	    prog, prog);
+    exit(-1);
+}
 
-		delete real_e;
+int main(int argc, char *argv[])
+{
+    struct sim_params p;
+    p.sim_time = 1000;
+    p.msg_arrivalint = 0.1;
+    p.msg_size = 100;
+    p.latency = 0.1;
+    p.bandwidth = 0;
+    p.queue = LINK_QUEUE;
+    p.aqm = AQM_DROPTAIL;
+    p.outoforder_rate = 0.15;
+    p.loss_rate = 0.15;
+    p.corrupt_rate = 0.15;
+    p.loss_model = LOSS_BERNOULLI;
+    p.ge_p = 0.01;
+    p.ge_r = 0.25;
+    p.ge_good_loss = 0;
+    p.ge_bad_loss = 1;
+    p.reorder_corr = 0;
+    p.impair_trace = NULL;
+    p.impair_record = NULL;
+    p.tracing_level = 0;
+    p.sched_kind = SCHED_HEAP4;
+    p.seed = getpid()+getppid();
+    p.json_file = NULL;
+    p.trace_file = "rdt_trace.bin";
+    p.rdt.protocol = PROTO_GBN;
+    p.rdt.rto = RTO_FIXED;
+    p.rdt.cc = CC_FIXED;
+    p.rdt.header = HDR_V1;
+    p.rdt.checksum = CSUM_CRC16;
+    p.rdt.send_buffer = SEND_BUFFER;
+    p.rdt.sack = false;
+    p.rdt.ack_every = 1;
+    p.rdt.ack_delay = ACK_DELAY;
+    p.rdt.coalesce = 0;
+    p.rdt.coalesce_delay = COALESCE_DELAY;
+    p.rdt.fast_rtx = FRTX_OFF;
+    p.rdt.fec = FEC_OFF;
+    p.rdt.fec_k = FEC_K;
+    p.rdt.fec_m = FEC_M;
+    p.rdt.connections = 1;
+    p.pdes = false;
+
+    bool batch = false;
+    const char *sweep = NULL;
+    int replicas = 5;
+    int njobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if ((argc==8 || argc==9) && argv[1][0]!='-') {
+	/* the classic positional form */
+	p.sim_time = atof(argv[1]);
+	p.msg_arrivalint = atof(argv[2]);
+	p.msg_size = atoi(argv[3]);
+	p.outoforder_rate = atof(argv[4]);
+	p.loss_rate = atof(argv[5]);
+	p.corrupt_rate = atof(argv[6]);
+	p.tracing_level = atoi(argv[7]);
+	if (argc==9) p.sched_kind = EventQueue_Parse(argv[8]);
+    }
+    else {
+	static const struct option options[] = {
+	    {"sim-time",    required_argument, NULL, 't'},
+	    {"arrival",     required_argument, NULL, 'a'},
+	    {"msg-size",    required_argument, NULL, 'm'},
+	    {"latency",     required_argument, NULL, 'L'},
+	    {"bandwidth",   required_argument, NULL, 'W'},
+	    {"queue",       required_argument, NULL, 'Q'},
+	    {"aqm",         required_argument, NULL, 'A'},
+	    {"outoforder",  required_argument, NULL, 'o'},
+	    {"loss",        required_argument, NULL, 'l'},
+	    {"corrupt",     required_argument, NULL, 'c'},
+	    {"loss-model",  required_argument, NULL, 'M'},
+	    {"ge-p",        required_argument, NULL, 'e'},
+	    {"ge-r",        required_argument, NULL, 'E'},
+	    {"ge-good-loss", required_argument, NULL, 'u'},
+	    {"ge-bad-loss", required_argument, NULL, 'U'},
+	    {"reorder-corr", required_argument, NULL, 'z'},
+	    {"impair-trace", required_argument, NULL, 'I'},
+	    {"record-impair", required_argument, NULL, 'O'},
+	    {"trace",       required_argument, NULL, 'v'},
+	    {"sched",       required_argument, NULL, 'S'},
+	    {"protocol",    required_argument, NULL, 'P'},
+	    {"rto",         required_argument, NULL, 'R'},
+	    {"cc",          required_argument, NULL, 'C'},
+	    {"header",      required_argument, NULL, 'H'},
+	    {"checksum",    required_argument, NULL, 'K'},
+	    {"send-buffer", required_argument, NULL, 'B'},
+	    {"sack",        no_argument,       NULL, 'k'},
+	    {"delayed-ack", required_argument, NULL, 'd'},
+	    {"ack-delay",   required_argument, NULL, 'D'},
+	    {"coalesce",    required_argument, NULL, 'g'},
+	    {"coalesce-delay", required_argument, NULL, 'G'},
+	    {"fast-retransmit", required_argument, NULL, 'F'},
+	    {"fec",         required_argument, NULL, 'f'},
+	    {"fec-k",       required_argument, NULL, 'x'},
+	    {"fec-m",       required_argument, NULL, 'y'},
+	    {"connections", required_argument, NULL, 'n'},
+	    {"pdes",        no_argument,       NULL, 'p'},
+	    {"seed",        required_argument, NULL, 's'},
+	    {"batch",       no_argument,       NULL, 'b'},
+	    {"json",        required_argument, NULL, 'J'},
+	    {"trace-file",  required_argument, NULL, 'T'},
+	    {"sweep",       required_argument, NULL, 'w'},
+	    {"replicas",    required_argument, NULL, 'r'},
+	    {"jobs",        required_argument, NULL, 'j'},
+	    {NULL, 0, NULL, 0}
+	};
+	int c;
+	while ((c = getopt_long(argc, argv, "", options, NULL))!=-1) {
+	    switch (c) {
+	    case 't': p.sim_time = atof(optarg); break;
+	    case 'a': p.msg_arrivalint = atof(optarg); break;
+	    case 'm': p.msg_size = atoi(optarg); break;
+	    case 'L': p.latency = atof(optarg); break;
+	    case 'W': p.bandwidth = atof(optarg); break;
+	    case 'Q': p.queue = atoi(optarg); break;
+	    case 'A': p.aqm = Aqm_Parse(optarg); break;
+	    case 'o': p.outoforder_rate = atof(optarg); break;
+	    case 'l': p.loss_rate = atof(optarg); break;
+	    case 'c': p.corrupt_rate = atof(optarg); break;
+	    case 'M': p.loss_model = Loss_Parse(optarg); break;
+	    case 'e': p.ge_p = atof(optarg); break;
+	    case 'E': p.ge_r = atof(optarg); break;
+	    case 'u': p.ge_good_loss = atof(optarg); break;
+	    case 'U': p.ge_bad_loss = atof(optarg); break;
+	    case 'z': p.reorder_corr = atof(optarg); break;
+	    case 'I': p.impair_trace = optarg; break;
+	    case 'O': p.impair_record = optarg; break;
+	    case 'v': p.tracing_level = atoi(optarg); break;
+	    case 'S': p.sched_kind = EventQueue_Parse(optarg); break;
+	    case 'P': p.rdt.protocol = Protocol_Parse(optarg); break;
+	    case 'R': p.rdt.rto = Rto_Parse(optarg); break;
+	    case 'C': p.rdt.cc = CC_Parse(optarg); break;
+	    case 'H': p.rdt.header = Header_Parse(optarg); break;
+	    case 'K': p.rdt.checksum = Checksum_Parse(optarg); break;
+	    case 'B': p.rdt.send_buffer = atoi(optarg); break;
+	    case 'k': p.rdt.sack = true; break;
+	    case 'd': p.rdt.ack_every = atoi(optarg); break;
+	    case 'D': p.rdt.ack_delay = atof(optarg); break;
+	    case 'g': p.rdt.coalesce = atoi(optarg); break;
+	    case 'G': p.rdt.coalesce_delay = atof(optarg); break;
+	    case 'F': p.rdt.fast_rtx = FastRtx_Parse(optarg); break;
+	    case 'f': p.rdt.fec = Fec_Parse(optarg); break;
+	    case 'x': p.rdt.fec_k = atoi(optarg); break;
+	    case 'y': p.rdt.fec_m = atoi(optarg); break;
+	    case 'n': p.rdt.connections = atoi(optarg); break;
+	    case 'p': p.pdes = true; break;
+	    case 's': p.seed = strtoul(optarg, NULL, 0); break;
+	    case 'b': batch = true; break;
+	    case 'J': p.json_file = optarg; break;
+	    case 'T': p.trace_file = optarg; break;
+	    case 'w': sweep = optarg; break;
+	    case 'r': replicas = atoi(optarg); break;
+	    case 'j': njobs = atoi(optarg); break;
+	    default: usage(argv[0]);
 	    }
-	    break;
-
-	default:
-	    fprintf(stderr, "undefined event %d\n", e->event_type);
-	    break;
 	}
+	if (optind!=argc) usage(argv[0]);
+	if (replicas<=0 || njobs<=0) usage(argv[0]);
     }
 
-    /* finalize the sender and the receiver */
-    Sender_Final();
-    Receiver_Final();
+    const char *err = Sim_CheckParams(&p);
+    if (err!=NULL) {
+	fprintf(stderr, "%s\n", err);
+	exit(-1);
+    }
 
-    fprintf(stdout, "\n");
-    fprintf(stdout, "## Simulation completed at time %.2fs with\n" 
-	    "\t%d characters sent\n" 
-	    "\t%d characters delivered\n"
-	    "\t%d packets passed between the sender and the receiver\n", 
-	    sim_core.time(), tot_chars_sent, tot_chars_delivered, tot_pkts_passed);
+    if (sweep!=NULL)
+	return Sweep_Run(&p, sweep, replicas, njobs)==0 ? 0 : -1;
 
-    if (message_verfication_passed && (tot_chars_sent==tot_chars_delivered))
-	fprintf(stdout, "## Congratulations! This session is error-free, loss-free, and in order.\n");
-    else
-	fprintf(stdout, "## Something is wrong! This session is NOT error-free, loss-free, and in order.\n");
+    fprintf(stdout, "## Reliable data transfer simulation with:\n"
+	    "\tsimulation time is %.3f seconds\n"
+	    "\taverage message arrival interval is %.3f seconds\n"
+	    "\taverage message size is %d bytes\n"
+	    "\tone-way packet latency is %.3f seconds\n"
+	    "\taverage out-of-order delivery rate is %.2f%%\n"
+	    "\taverage loss rate is %.2f%%\n"
+	    "\taverage corrupt rate is %.2f%%\n"
+	    "\ttracing level is %d\n"
+	    "\tevent scheduler is %s\n"
+	    "\tprotocol is %s\n"
+	    "\tretransmission timeout is %s\n"
+	    "\tcongestion control is %s\n"
+	    "\tpacket header is %s with %s%s\n"
+	    "\tsend buffer holds %d packets\n"
+	    "\trandom seed is %lu\n",
+	    p.sim_time, p.msg_arrivalint, p.msg_size, p.latency,
+	    p.outoforder_rate*100.0, p.loss_rate*100.0, p.corrupt_rate*100.0,
+	    p.tracing_level, EventQueue_Name(p.sched_kind),
+	    Protocol_Name(p.rdt.protocol), Rto_Name(p.rdt.rto),
+	    CC_Name(p.rdt.cc), Header_Name(p.rdt.header),
+	    Checksum_Name(p.rdt.checksum), p.rdt.sack ? " and SACK blocks" : "",
+	    p.rdt.send_buffer, p.seed);
+    if (p.rdt.ack_every>1)
+	fprintf(stdout, "\tacks are delayed, one per %d in-order packets or %.3f seconds\n",
+		p.rdt.ack_every, p.rdt.ack_delay);
+    if (p.rdt.coalesce>0)
+	fprintf(stdout, "\tmessages are coalesced, a packet goes out with %d bytes "
+		"or after %.3f seconds\n", p.rdt.coalesce, p.rdt.coalesce_delay);
+    if (p.rdt.fast_rtx!=FRTX_OFF)
+	fprintf(stdout, "\tduplicate acks trigger fast %s\n",
+		p.rdt.fast_rtx==FRTX_RECOVERY ? "retransmit and recovery" : "retransmit");
+    if (p.rdt.fec!=FEC_OFF)
+	fprintf(stdout, "\tforward error correction is %s, %d parity packets per %d data packets\n",
+		Fec_Name(p.rdt.fec), Fec_Parities(p.rdt.fec, p.rdt.fec_m), p.rdt.fec_k);
+    if (p.rdt.connections>1)
+	fprintf(stdout, "\t%d connections share the link\n", p.rdt.connections);
+    if (p.loss_model==LOSS_GE)
+	fprintf(stdout, "\tlosses come in bursts (gilbert-elliott, p %.3f, r %.3f, "
+		"loss %.2f%% good, %.2f%% bad, %.2f%% on average)\n",
+		p.ge_p, p.ge_r, p.ge_good_loss*100.0, p.ge_bad_loss*100.0,
+		p.ge_p + p.ge_r>0 ? 100.0 * (p.ge_r*p.ge_good_loss + p.ge_p*p.ge_bad_loss) /
+		(p.ge_p + p.ge_r) : p.ge_good_loss*100.0);
+    if (p.loss_model==LOSS_TRACE)
+	fprintf(stdout, "\tlosses and delays are replayed from %s\n", p.impair_trace);
+    if (p.reorder_corr>0)
+	fprintf(stdout, "\treordering is correlated, %.2f\n", p.reorder_corr);
+    if (p.impair_record!=NULL)
+	fprintf(stdout, "\tlosses and delays are recorded to %s\n", p.impair_record);
+    if (p.bandwidth>0)
+	fprintf(stdout, "\tlink bandwidth is %.0f bytes/sec with a %s queue of %d packets\n",
+		p.bandwidth, Aqm_Name(p.aqm), p.queue);
+    if (p.pdes)
+	fprintf(stdout, "\tsender and receiver run in parallel with a lookahead of %.4f seconds\n",
+		Sim_Lookahead(&p));
+    if (!batch) {
+	fprintf(stdout, "Please review these inputs and press <enter> to proceed.\n");
+	fgetc(stdin);
+    }
+
+    struct sim_result r;
+    Sim_Run(&p, &r);
 
     return 0;
 }
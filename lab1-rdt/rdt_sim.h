@@ -0,0 +1,78 @@
+/*
+ * FILE: rdt_sim.h
+ * DESCRIPTION: The header file for driving the simulation programmatically,
+ *       used by the batch/sweep runner.
+ */
+
+
+#ifndef _RDT_SIM_H_
+#define _RDT_SIM_H_
+
+#include "rdt_config.h"
+#include "rdt_link.h"
+
+/* parameters of one simulation run, see the globals in rdt_sim.cc */
+struct sim_params {
+    double sim_time;
+    double msg_arrivalint;
+    int msg_size;
+    double latency;                 /* one-way packet latency */
+    double bandwidth;               /* link bandwidth (bytes/sec), 0 for no limit */
+    int queue;                      /* link queue capacity (in packets) */
+    int aqm;                        /* link queue discipline */
+    double outoforder_rate;
+    double loss_rate;
+    double corrupt_rate;
+    int loss_model;                 /* see rdt_impair.h */
+    double ge_p;                    /* gilbert-elliott: good to bad */
+    double ge_r;                    /* and bad to good, per packet */
+    double ge_good_loss;            /* loss rates of the two states */
+    double ge_bad_loss;
+    double reorder_corr;            /* correlation of reordering */
+    const char *impair_trace;       /* replayed by the trace model */
+    const char *impair_record;      /* impairment trace output, NULL for none */
+    int tracing_level;
+    int sched_kind;
+    unsigned long seed;
+    const char *json_file;          /* metrics output, NULL for none */
+    const char *trace_file;         /* binary trace output, NULL for none */
+    struct rdt_config rdt;          /* protocol configuration */
+    bool pdes;                      /* parallel run, see rdt_pdes.h */
+};
+
+/* outcome of one simulation run */
+struct sim_result {
+    double end_time;                /* simulation time at the end */
+    long long chars_sent;
+    long long chars_delivered;
+    long long pkts_passed;
+    unsigned long long events;      /* events processed by the simulator */
+    double wall_time;               /* wall-clock time of the event loop */
+    bool verified;                  /* error-free, loss-free, and in order */
+    long long retransmissions;
+    long long spurious;             /* retransmissions the receiver already had */
+    double recovery_mean;           /* mean time to recover a lost packet */
+    double memory_per_conn;         /* connection state allocated per connection */
+    struct link_stats s2r;          /* link from the sender to the receiver */
+    struct link_stats r2s;          /* and back */
+};
+
+/* the least time a packet takes to cross the link, the lookahead of a
+   parallel run */
+double Sim_Lookahead(const struct sim_params *p);
+
+/* check the parameters, return an error message or NULL if they are valid */
+const char *Sim_CheckParams(const struct sim_params *p);
+
+/* run one complete simulation.  the rdt layers keep their state in globals,
+   so this can only be called once per process; the sweep runner forks a
+   fresh process for every run */
+void Sim_Run(const struct sim_params *p, struct sim_result *r);
+
+/* run every combination of the sweep spec for the given number of replicas
+   on up to njobs processes in parallel, print aggregated results.
+   return 0 on success, -1 if the spec is invalid */
+int Sweep_Run(const struct sim_params *base, const char *spec, int replicas,
+              int njobs);
+
+#endif  /* _RDT_SIM_H_ */
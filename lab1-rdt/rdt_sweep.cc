@@ -0,0 +1,335 @@
+/*
+ * FILE: rdt_sweep.cc
+ * DESCRIPTION: Parallel parameter-sweep runner.
+ *
+ *       A sweep spec such as "loss=0:0.3:0.1,msg-size=100/1000" expands to
+ *       the cartesian product of its parameter values.  Every point is run
+ *       for a number of replicas with seeds seed, seed+1, ..., so the same
+ *       replica sees the same random numbers at every point.  Each run is a
+ *       forked child process (the rdt layers keep their state in globals),
+ *       with up to njobs children alive at a time.  A child reports its
+ *       sim_result back through a pipe; the parent aggregates goodput and
+ *       packets passed per point with 95% confidence intervals, along with
+ *       the mean spurious retransmission ratio, recovery time, memory per
+ *       connection, and the share of packets the link queues dropped along
+ *       with the mean queue of the data direction.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#include "rdt_sim.h"
+#include "rdt_cc.h"
+#include "rdt_header.h"
+#include "rdt_fec.h"
+#include "rdt_link.h"
+#include "rdt_impair.h"
+
+
+/* sweepable parameters */
+enum {SWEEP_OUTOFORDER=0, SWEEP_LOSS, SWEEP_CORRUPT, SWEEP_MSGSIZE,
+      SWEEP_ARRIVAL, SWEEP_LATENCY, SWEEP_BANDWIDTH, SWEEP_QUEUE,
+      SWEEP_CONNECTIONS, SWEEP_NUM};
+
+static const char *sweep_names[SWEEP_NUM] = {
+    "outoforder", "loss", "corrupt", "msg-size", "arrival", "latency",
+    "bandwidth", "queue", "connections"
+};
+
+struct sweep_axis {
+    int param;
+    std::vector<double> values;
+};
+
+/* a run handed out to a child process */
+struct sweep_job {
+    int point;              /* index of the sweep point */
+    struct sim_params params;
+    pid_t pid;
+    int fd;                 /* read end of the result pipe */
+};
+
+/* two-sided 95% quantiles of Student's t distribution, df = 1..30 */
+static const double t95[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/* running mean/variance (Welford) of one metric at one sweep point */
+struct sweep_stat {
+    int n;
+    double mean;
+    double m2;
+
+    sweep_stat() { n = 0; mean = 0; m2 = 0; }
+
+    void add(double x) {
+	n++;
+	double d = x - mean;
+	mean += d / n;
+	m2 += d * (x - mean);
+    }
+
+    /* half width of the 95% confidence interval of the mean */
+    double ci95() const {
+	if (n<2) return 0;
+	double t = n-1<=30 ? t95[n-2] : 1.96;
+	return t * sqrt(m2 / (n-1) / n);
+    }
+};
+
+
+/* parse one "name=lo:hi:step" or "name=v1/v2/..." item */
+static int parse_axis(const std::string &item, struct sweep_axis *axis)
+{
+    size_t eq = item.find('=');
+    if (eq==std::string::npos) return -1;
+
+    std::string name = item.substr(0, eq);
+    std::string vals = item.substr(eq+1);
+    axis->param = -1;
+    for (int i=0; i<SWEEP_NUM; i++)
+	if (name==sweep_names[i]) axis->param = i;
+    if (axis->param<0 || vals.empty()) return -1;
+
+    axis->values.clear();
+    if (vals.find(':')!=std::string::npos) {
+	double lo, hi, step;
+	char extra;
+	if (sscanf(vals.c_str(), "%lf:%lf:%lf%c", &lo, &hi, &step, &extra)!=3 ||
+	    step<=0 || hi<lo)
+	    return -1;
+	/* tolerate rounding so that the upper bound is included */
+	for (int i=0; lo + i*step<=hi + step*1e-9; i++)
+	    axis->values.push_back(lo + i*step);
+    }
+    else {
+	size_t start = 0;
+	while (start<=vals.size()) {
+	    size_t end = vals.find('/', start);
+	    if (end==std::string::npos) end = vals.size();
+	    std::string v = vals.substr(start, end-start);
+	    char *stop;
+	    double x = strtod(v.c_str(), &stop);
+	    if (v.empty() || *stop!='\0') return -1;
+	    axis->values.push_back(x);
+	    start = end + 1;
+	}
+    }
+    return 0;
+}
+
+static void set_param(struct sim_params *p, int param, double v)
+{
+    switch (param) {
+    case SWEEP_OUTOFORDER: p->outoforder_rate = v; break;
+    case SWEEP_LOSS:       p->loss_rate = v; break;
+    case SWEEP_CORRUPT:    p->corrupt_rate = v; break;
+    case SWEEP_MSGSIZE:    p->msg_size = (int) v; break;
+    case SWEEP_ARRIVAL:    p->msg_arrivalint = v; break;
+    case SWEEP_LATENCY:    p->latency = v; break;
+    case SWEEP_BANDWIDTH:  p->bandwidth = v; break;
+    case SWEEP_QUEUE:      p->queue = (int) v; break;
+    case SWEEP_CONNECTIONS: p->rdt.connections = (int) v; break;
+    }
+}
+
+/* fork a child running one job, return 0 on success */
+static int start_job(struct sweep_job *job)
+{
+    int fds[2];
+    if (pipe(fds)<0) return -1;
+
+    pid_t pid = fork();
+    if (pid<0) {
+	close(fds[0]);
+	close(fds[1]);
+	return -1;
+    }
+
+    if (pid==0) {
+	/* child: silence the per-run output and report through the pipe */
+	close(fds[0]);
+	int devnull = open("/dev/null", O_WRONLY);
+	if (devnull>=0) {
+	    dup2(devnull, STDOUT_FILENO);
+	    dup2(devnull, STDERR_FILENO);
+	}
+	struct sim_result r;
+	Sim_Run(&job->params, &r);
+	fflush(stdout);
+	ssize_t n = write(fds[1], &r, sizeof(r));
+	_exit(n==(ssize_t) sizeof(r) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    job->pid = pid;
+    job->fd = fds[0];
+    return 0;
+}
+
+/* collect the result of a finished job, return 0 if the child reported one */
+static int finish_job(struct sweep_job *job, struct sim_result *r)
+{
+    ssize_t n;
+    do {
+	n = read(job->fd, r, sizeof(*r));
+    } while (n<0 && errno==EINTR);
+    close(job->fd);
+    return n==(ssize_t) sizeof(*r) ? 0 : -1;
+}
+
+int Sweep_Run(const struct sim_params *base, const char *spec, int replicas,
+	      int njobs)
+{
+    /* parse the spec into axes */
+    std::vector<struct sweep_axis> axes;
+    std::string s(spec);
+    size_t start = 0;
+    while (start<=s.size()) {
+	size_t end = s.find(',', start);
+	if (end==std::string::npos) end = s.size();
+	struct sweep_axis axis;
+	if (parse_axis(s.substr(start, end-start), &axis)<0) {
+	    fprintf(stderr, "invalid sweep item \"%s\"\n",
+		    s.substr(start, end-start).c_str());
+	    return -1;
+	}
+	axes.push_back(axis);
+	start = end + 1;
+    }
+
+    /* expand the cartesian product into sweep points */
+    std::vector<struct sim_params> points(1, *base);
+    for (size_t a=0; a<axes.size(); a++) {
+	std::vector<struct sim_params> next;
+	for (size_t i=0; i<points.size(); i++)
+	    for (size_t v=0; v<axes[a].values.size(); v++) {
+		struct sim_params p = points[i];
+		set_param(&p, axes[a].param, axes[a].values[v]);
+		next.push_back(p);
+	    }
+	points.swap(next);
+    }
+    for (size_t i=0; i<points.size(); i++) {
+	const char *err = Sim_CheckParams(&points[i]);
+	if (err!=NULL) {
+	    fprintf(stderr, "sweep point %zu: %s\n", i, err);
+	    return -1;
+	}
+    }
+
+    /* the job list, point-major so that early points finish first */
+    std::vector<struct sweep_job> jobs;
+    for (size_t i=0; i<points.size(); i++)
+	for (int k=0; k<replicas; k++) {
+	    struct sweep_job job;
+	    job.point = (int) i;
+	    job.params = points[i];
+	    job.params.tracing_level = 0;
+	    job.params.json_file = NULL;
+	    job.params.trace_file = NULL;
+	    job.params.impair_record = NULL;
+	    job.params.seed = base->seed + k;
+	    job.pid = -1;
+	    job.fd = -1;
+	    jobs.push_back(job);
+	}
+
+    fprintf(stdout, "## Sweep of %zu points x %d replicas on %d jobs, seeds %lu..%lu, "
+	    "protocol %s, %s rto, %s cc, header %s, %s%s, ack every %d, "
+	    "coalesce %d, fast retransmit %s, fec %s, %s queue, %s losses\n",
+	    points.size(), replicas, njobs,
+	    base->seed, base->seed + replicas - 1, Protocol_Name(base->rdt.protocol),
+	    Rto_Name(base->rdt.rto), CC_Name(base->rdt.cc), Header_Name(base->rdt.header),
+	    Checksum_Name(base->rdt.checksum), base->rdt.sack ? ", sack" : "",
+	    base->rdt.ack_every, base->rdt.coalesce, FastRtx_Name(base->rdt.fast_rtx),
+	    Fec_Name(base->rdt.fec), Aqm_Name(base->aqm),
+	    Loss_Name(base->loss_model));
+    fflush(stdout);
+
+    std::vector<sweep_stat> goodput(points.size()), pkts(points.size());
+    std::vector<sweep_stat> spurious(points.size()), recovery(points.size());
+    std::vector<sweep_stat> memory(points.size());
+    std::vector<sweep_stat> qdrops(points.size()), qmean(points.size());
+    std::vector<int> verified(points.size(), 0), failed(points.size(), 0);
+
+    size_t next = 0, running = 0;
+    while (next<jobs.size() || running>0) {
+	if (next<jobs.size() && running<(size_t) njobs) {
+	    if (start_job(&jobs[next])<0) {
+		fprintf(stderr, "cannot start sweep run: %s\n", strerror(errno));
+		if (running==0) return -1;
+	    }
+	    else {
+		next++;
+		running++;
+		continue;
+	    }
+	}
+
+	int status;
+	pid_t pid = wait(&status);
+	if (pid<0) {
+	    if (errno==EINTR) continue;
+	    break;
+	}
+	for (size_t j=0; j<next; j++) {
+	    if (jobs[j].pid!=pid) continue;
+	    struct sim_result r;
+	    int pt = jobs[j].point;
+	    if (finish_job(&jobs[j], &r)==0 && WIFEXITED(status) &&
+		WEXITSTATUS(status)==0) {
+		goodput[pt].add(r.end_time>0 ? r.chars_delivered / r.end_time : 0);
+		pkts[pt].add((double) r.pkts_passed);
+		spurious[pt].add(r.retransmissions>0 ?
+				 (double) r.spurious / r.retransmissions : 0);
+		recovery[pt].add(r.recovery_mean);
+		memory[pt].add(r.memory_per_conn);
+		long long offered = r.s2r.offered + r.r2s.offered;
+		qdrops[pt].add(offered>0 ? (double) (r.s2r.tail_drops + r.s2r.early_drops +
+						     r.r2s.tail_drops + r.r2s.early_drops)
+				   / offered : 0);
+		qmean[pt].add(r.end_time>0 ? r.s2r.sojourn / r.end_time : 0);
+		if (r.verified) verified[pt]++;
+	    }
+	    else
+		failed[pt]++;
+	    jobs[j].pid = -1;
+	    running--;
+	    break;
+	}
+    }
+
+    /* report */
+    fprintf(stdout, "%10s %6s %7s %8s %8s %7s %9s %5s %6s %12s %10s %12s %10s %9s "
+	    "%11s %8s %6s %6s %8s\n",
+	    "outoforder", "loss", "corrupt", "msg-size", "arrival", "latency", "bandwidth",
+	    "queue", "conns", "goodput(B/s)", "+-95%", "pkts-passed", "+-95%", "spurious%",
+	    "recovery(s)", "KB/conn", "qdrop%", "qmean", "ok/runs");
+    for (size_t i=0; i<points.size(); i++) {
+	const struct sim_params *p = &points[i];
+	fprintf(stdout, "%10.3f %6.3f %7.3f %8d %8.3f %7.3f %9.0f %5d %6d %12.1f %10.1f "
+		"%12.0f %10.0f %9.1f %11.3f %8.1f %6.2f %6.2f %4d/%d",
+		p->outoforder_rate, p->loss_rate, p->corrupt_rate, p->msg_size,
+		p->msg_arrivalint, p->latency, p->bandwidth, p->queue, p->rdt.connections,
+		goodput[i].mean, goodput[i].ci95(), pkts[i].mean, pkts[i].ci95(),
+		spurious[i].mean*100, recovery[i].mean, memory[i].mean / 1024,
+		qdrops[i].mean*100, qmean[i].mean, verified[i], replicas);
+	if (failed[i]>0) fprintf(stdout, " (%d aborted)", failed[i]);
+	fprintf(stdout, "\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * FILE: rdt_timer.cc
+ * DESCRIPTION: Hashed timer wheel for per-packet retransmission timers.
+ */
+
+
+#include <math.h>
+
+#include "rdt_timer.h"
+
+
+TimerWheel::TimerWheel(int ntimers, double tick, int nbuckets)
+{
+    int n = 64;
+    while (n<nbuckets) n <<= 1;
+
+    entry e = {0, 0, -1, -1, -1};
+    timers.assign(ntimers, e);
+    heads.assign(n, -1);
+    nonempty.assign(n/64, 0);
+    this->tick = tick;
+    mask = n - 1;
+    count = 0;
+    nstamps = 0;
+    floor_tick = 0;
+    earliest = -1;
+}
+
+long long TimerWheel::tick_of(double t) const
+{
+    return (long long) floor(t / tick);
+}
+
+bool TimerWheel::before(int a, int b) const
+{
+    return timers[a].expire < timers[b].expire ||
+	(timers[a].expire == timers[b].expire && timers[a].stamp < timers[b].stamp);
+}
+
+void TimerWheel::link(int id)
+{
+    int b = (int)(tick_of(timers[id].expire) & mask);
+    entry &e = timers[id];
+    e.bucket = b;
+    e.prev = -1;
+    e.next = heads[b];
+    if (heads[b]>=0) timers[heads[b]].prev = id;
+    heads[b] = id;
+    nonempty[b >> 6] |= 1ULL << (b & 63);
+}
+
+void TimerWheel::unlink(int id)
+{
+    entry &e = timers[id];
+    if (e.prev>=0) timers[e.prev].next = e.next;
+    else heads[e.bucket] = e.next;
+    if (e.next>=0) timers[e.next].prev = e.prev;
+    if (heads[e.bucket]<0)
+	nonempty[e.bucket >> 6] &= ~(1ULL << (e.bucket & 63));
+    e.bucket = -1;
+}
+
+void TimerWheel::set(int id, double expire)
+{
+    if (armed(id)) cancel(id);
+
+    timers[id].expire = expire;
+    timers[id].stamp = nstamps++;
+    link(id);
+    count++;
+
+    long long t = tick_of(expire);
+    if (count==1 || t<floor_tick) floor_tick = t;
+    if (earliest>=0 && before(id, earliest)) earliest = id;
+    else if (count==1) earliest = id;
+}
+
+void TimerWheel::cancel(int id)
+{
+    if (!armed(id)) return;
+
+    unlink(id);
+    count--;
+    if (earliest==id) earliest = -1;
+}
+
+/* walk the non-empty buckets from floor_tick on, the first bucket holding a
+   timer of its current round holds the earliest timer */
+int TimerWheel::find_earliest()
+{
+    int nbuckets = mask + 1;
+    long long t = floor_tick;
+    while (t<floor_tick + nbuckets) {
+	int b = (int)(t & mask);
+	uint64_t word = nonempty[b >> 6] >> (b & 63);
+	if (word==0) {
+	    /* skip to the next bitmap word */
+	    t += 64 - (b & 63);
+	    continue;
+	}
+	int skip = __builtin_ctzll(word);
+	t += skip;
+	b += skip;
+	if (t>=floor_tick + nbuckets) break;
+
+	int best = -1;
+	for (int id=heads[b]; id>=0; id=timers[id].next)
+	    if (tick_of(timers[id].expire)<=t && (best<0 || before(id, best)))
+		best = id;
+	if (best>=0) {
+	    floor_tick = t;
+	    return best;
+	}
+	t++;
+    }
+
+    /* every timer is at least a revolution ahead, find it the slow way */
+    int best = -1;
+    for (int b=0; b<nbuckets; b++)
+	for (int id=heads[b]; id>=0; id=timers[id].next)
+	    if (best<0 || before(id, best)) best = id;
+    if (best>=0) floor_tick = tick_of(timers[best].expire);
+    return best;
+}
+
+int TimerWheel::next()
+{
+    if (count==0) return -1;
+    if (earliest<0) earliest = find_earliest();
+    return earliest;
+}
+
+int TimerWheel::pop_expired(double now)
+{
+    int id = next();
+    if (id<0 || timers[id].expire>now) return -1;
+
+    cancel(id);
+    return id;
+}
@@ -0,0 +1,86 @@
+/*
+ * FILE: rdt_timer.h
+ * DESCRIPTION: Hashed timer wheel for per-packet retransmission timers.
+ *
+ *       Timers are identified by a small integer (the sequence number) and
+ *       live in a fixed array, so arming, re-arming and cancelling a timer
+ *       is O(1).  Armed timers are also hashed by expiry tick into one of
+ *       nbuckets buckets (doubly linked through the array); a bitmap of
+ *       non-empty buckets lets the earliest timer be found by skipping empty
+ *       buckets a word at a time.  Timers more than one revolution ahead
+ *       simply stay in their bucket until their round comes up.
+ *
+ *       The wheel does not schedule anything by itself: the sender arms the
+ *       single simulator timer for next_expiry() and drains pop_expired()
+ *       when it fires.
+ */
+
+
+#ifndef _RDT_TIMER_H_
+#define _RDT_TIMER_H_
+
+#include <stdint.h>
+#include <vector>
+
+
+class TimerWheel
+{
+    struct entry {
+	double expire;
+	unsigned long long stamp;   /* arming order, breaks ties on expire */
+	int bucket;                 /* -1 when not armed */
+	int prev, next;             /* bucket list links, -1 terminated */
+    };
+
+    std::vector<entry> timers;
+    std::vector<int> heads;         /* first timer of every bucket */
+    std::vector<uint64_t> nonempty; /* bitmap of non-empty buckets */
+    double tick;                    /* time span of one bucket */
+    int mask;                       /* nbuckets - 1 */
+    int count;                      /* armed timers */
+    unsigned long long nstamps;
+    long long floor_tick;           /* no armed timer expires before it */
+    int earliest;                   /* cached earliest timer, -1 if unknown */
+
+    long long tick_of(double t) const;
+    bool before(int a, int b) const;
+    void link(int id);
+    void unlink(int id);
+    int find_earliest();
+
+public:
+    /* ids are 0..ntimers-1, nbuckets is rounded up to a power of two */
+    TimerWheel(int ntimers, double tick = 0.01, int nbuckets = 256);
+
+    /* arm timer id to expire at the given time, re-arming it if needed */
+    void set(int id, double expire);
+
+    /* disarm timer id, do nothing if it is not armed */
+    void cancel(int id);
+
+    bool armed(int id) const { return timers[id].bucket>=0; }
+    double expire(int id) const { return timers[id].expire; }
+    int size() const { return count; }
+
+    /* bytes allocated for the wheel */
+    size_t memory() const {
+	return sizeof(*this) + timers.capacity() * sizeof(entry) +
+	    heads.capacity() * sizeof(int) + nonempty.capacity() * sizeof(uint64_t);
+    }
+
+    /* the earliest armed timer, -1 if none is armed */
+    int next();
+
+    /* expiry of the earliest armed timer, -1 if none is armed */
+    double next_expiry() {
+	int id = next();
+	return id<0 ? -1 : timers[id].expire;
+    }
+
+    /* disarm and return the earliest timer if it expires at or before now,
+       -1 otherwise.  timers expiring at the same time come out in the order
+       they were armed */
+    int pop_expired(double now);
+};
+
+#endif  /* _RDT_TIMER_H_ */
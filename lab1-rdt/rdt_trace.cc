@@ -0,0 +1,64 @@
+/*
+ * FILE: rdt_trace.cc
+ * DESCRIPTION: Trace ring buffer and trace file output.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdt_trace.h"
+
+
+struct trace_ring trace_ring;
+
+const char *trace_formats[TR_NUM] = {
+    /* TR_SENDER_INIT */    "sender initializing ...",
+    /* TR_SENDER_FINAL */   "sender finalizing ...",
+    /* TR_SEND */           "sending pkt %d to lower layer, size %.0f",
+    /* TR_QUEUE */          "push pkt %d to waiting buffer, %.0f waiting",
+    /* TR_ACK */            "receive packet %d ack, kind %.0f",
+    /* TR_ACK_CORRUPT */    "ack packet %d checksum mismatch",
+    /* TR_TIMEOUT */        "timeout and resending pkt %d to lower layer",
+    /* TR_RESEND */         "resending pkt %d to lower layer",
+    /* TR_TIMER_ADD */      "start Timer %d, expire time %.2fs",
+    /* TR_TIMER_STOP */     "cancel timer %d",
+    /* TR_TIMER_RESTART */  "restart timer for pkt %d, rest time %.2fs",
+    /* TR_RECEIVER_INIT */  "receiver initializing ...",
+    /* TR_RECEIVER_FINAL */ "receiver finalizing ...",
+    /* TR_RECV */           "Receiver: receive %d, size %.0f",
+    /* TR_RECV_CORRUPT */   "Receiver: packet checksum mismatch",
+    /* TR_RECV_OUTSIDE */   "Receiver: packet %d, not in region, expect %.0f",
+    /* TR_ACK_SEND */       "Receiver: ack seq %d send, kind %.0f",
+    /* TR_DELIVER */        "Receiver: submitting message, size %d",
+};
+
+int Trace_Dump(const char *path)
+{
+    if (RDT_TRACE_LEVEL==0) return 0;
+
+    FILE *f = fopen(path, "wb");
+    if (f==NULL) return -1;
+
+    struct trace_file_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TRACE_MAGIC;
+    h.version = TRACE_VERSION;
+    h.record_size = sizeof(struct trace_record);
+    h.total = trace_ring.total;
+    h.count = trace_ring.total<TRACE_RING_SIZE ? trace_ring.total : TRACE_RING_SIZE;
+
+    int ok = fwrite(&h, sizeof(h), 1, f)==1;
+
+    /* oldest record first: the ring has wrapped if total exceeds its size */
+    uint64_t first = trace_ring.total - h.count;
+    for (uint64_t i=0; ok && i<h.count; i++) {
+	const struct trace_record *r =
+	    &trace_ring.records[(first + i) & (TRACE_RING_SIZE - 1)];
+	ok = fwrite(r, sizeof(*r), 1, f)==1;
+    }
+
+    if (fclose(f)!=0) ok = 0;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,100 @@
+/*
+ * FILE: rdt_trace.h
+ * DESCRIPTION: Leveled binary tracing for the rdt sender and receiver.
+ *
+ *       RDT_TRACE(level, event, a, x) records a trace event if level is at
+ *       most RDT_TRACE_LEVEL, a build-time constant (make TRACE=n).  Above
+ *       the threshold the macro expands to dead code that the compiler drops
+ *       together with its arguments, so a default build pays nothing.
+ *       Below it, each event is a fixed-size binary record in an in-memory
+ *       ring buffer that keeps the most recent TRACE_RING_SIZE events; the
+ *       ring is written to a file at the end of the run and decoded offline
+ *       by rdt_tracedump.
+ */
+
+
+#ifndef _RDT_TRACE_H_
+#define _RDT_TRACE_H_
+
+#include <stdint.h>
+
+
+#ifndef RDT_TRACE_LEVEL
+#define RDT_TRACE_LEVEL 0
+#endif
+
+/* trace levels */
+#define TRACE_INFO      1       /* once per run or per message */
+#define TRACE_PACKET    2       /* every packet sent or received */
+#define TRACE_TIMER     3       /* retransmission timer internals */
+
+/* trace events, see trace_formats in rdt_trace.cc for their arguments */
+enum {
+    TR_SENDER_INIT=0, TR_SENDER_FINAL, TR_SEND, TR_QUEUE, TR_ACK,
+    TR_ACK_CORRUPT, TR_TIMEOUT, TR_RESEND, TR_TIMER_ADD, TR_TIMER_STOP,
+    TR_TIMER_RESTART,
+    TR_RECEIVER_INIT, TR_RECEIVER_FINAL, TR_RECV, TR_RECV_CORRUPT,
+    TR_RECV_OUTSIDE, TR_ACK_SEND, TR_DELIVER,
+    TR_NUM
+};
+
+/* one binary trace record */
+struct trace_record {
+    double time;            /* simulation time */
+    double x;               /* event argument, e.g. a time or a size */
+    int32_t a;              /* event argument, usually a sequence number */
+    uint16_t event;
+    uint16_t level;
+};
+
+/* number of records kept in the ring, a power of two */
+#define TRACE_RING_SIZE (1 << 16)
+
+/* trace file layout: a trace_file_header followed by header.count records,
+   oldest first */
+#define TRACE_MAGIC 0x45434152544452ULL     /* "RDTRACE" */
+#define TRACE_VERSION 2
+
+struct trace_file_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;         /* records in the file */
+    uint64_t total;         /* records traced, including overwritten ones */
+};
+
+struct trace_ring {
+    struct trace_record records[TRACE_RING_SIZE];
+    uint64_t total;
+};
+extern struct trace_ring trace_ring;
+
+/* printf format of every event, given the arguments (a, x); a format
+   that uses x must consume a with a %d first */
+extern const char *trace_formats[TR_NUM];
+
+/* get simulation time (in seconds) */
+double GetSimulationTime();
+
+static inline void Trace_Record(int level, int event, int32_t a, double x)
+{
+    struct trace_record *r =
+	&trace_ring.records[trace_ring.total++ & (TRACE_RING_SIZE - 1)];
+    r->time = GetSimulationTime();
+    r->x = x;
+    r->a = a;
+    r->event = (uint16_t) event;
+    r->level = (uint16_t) level;
+}
+
+#define RDT_TRACE(level, event, a, x) \
+    do { \
+        if ((level) <= RDT_TRACE_LEVEL) \
+            Trace_Record((level), (event), (int32_t) (a), (double) (x)); \
+    } while (0)
+
+/* write the ring to a trace file, return 0 on success.  does nothing
+   when tracing is compiled out */
+int Trace_Dump(const char *path);
+
+#endif  /* _RDT_TRACE_H_ */
@@ -0,0 +1,80 @@
+/*
+ * FILE: rdt_tracedump.cc
+ * DESCRIPTION: Offline decoder of binary trace files written by rdt_sim.
+ *
+ *       usage: rdt_tracedump [-l max_level] <trace_file>
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rdt_trace.h"
+
+
+/* the decoder has no simulation clock of its own */
+double GetSimulationTime()
+{
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_level = TRACE_TIMER;
+    int c;
+    while ((c = getopt(argc, argv, "l:"))!=-1) {
+	switch (c) {
+	case 'l': max_level = atoi(optarg); break;
+	default:
+	    fprintf(stderr, "usage: %s [-l max_level] <trace_file>\n", argv[0]);
+	    exit(-1);
+	}
+    }
+    if (optind!=argc-1) {
+	fprintf(stderr, "usage: %s [-l max_level] <trace_file>\n", argv[0]);
+	exit(-1);
+    }
+
+    FILE *f = fopen(argv[optind], "rb");
+    if (f==NULL) {
+	fprintf(stderr, "cannot open %s\n", argv[optind]);
+	exit(-1);
+    }
+
+    struct trace_file_header h;
+    if (fread(&h, sizeof(h), 1, f)!=1 || h.magic!=TRACE_MAGIC) {
+	fprintf(stderr, "%s is not a trace file\n", argv[optind]);
+	exit(-1);
+    }
+    if (h.version!=TRACE_VERSION || h.record_size!=sizeof(struct trace_record)) {
+	fprintf(stderr, "unsupported trace file version %u (record size %u)\n",
+		h.version, h.record_size);
+	exit(-1);
+    }
+
+    if (h.total>h.count)
+	fprintf(stdout, "## %llu of %llu records, the oldest were overwritten\n",
+		(unsigned long long) h.count, (unsigned long long) h.total);
+
+    struct trace_record r;
+    for (uint64_t i=0; i<h.count; i++) {
+	if (fread(&r, sizeof(r), 1, f)!=1) {
+	    fprintf(stderr, "trace file truncated after %llu records\n",
+		    (unsigned long long) i);
+	    exit(-1);
+	}
+	if (r.level>max_level) continue;
+
+	fprintf(stdout, "At %.6fs: ", r.time);
+	if (r.event<TR_NUM)
+	    fprintf(stdout, trace_formats[r.event], r.a, r.x);
+	else
+	    fprintf(stdout, "unknown event %u (%d, %g)", r.event, r.a, r.x);
+	fputc('\n', stdout);
+    }
+
+    fclose(f);
+    return 0;
+}